@@ -0,0 +1,118 @@
+// Cost and payoff of subtree augmentation on RedBlackTree.
+//
+// The same key stream goes into an unaugmented tree, one keeping counts and
+// one keeping KeyStats (count, sum, min, max). Updates show what maintaining
+// summaries costs; range queries compare aggregate(from, to) against the
+// in-order scan an unaugmented tree has to do.
+//
+// Usage: ./bench_aggregate [key_count] [queries]
+//        defaults: 1,000,000 keys, 2,000 range queries per width
+#include "rbtree/tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+template<typename F>
+static double nsPerOp(size_t ops, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / std::max<size_t>(ops, 1);
+}
+
+template<typename Tree>
+static void runUpdates(const char* name, const std::vector<int64_t>& keys, const std::vector<int64_t>& removals) {
+    Tree tree;
+    const double insert = nsPerOp(keys.size(), [&] {
+        for (int64_t k : keys) tree.insert(k);
+    });
+    size_t hits = 0;
+    const double lookup = nsPerOp(keys.size(), [&] {
+        for (int64_t k : removals) hits += tree.search(k);
+    });
+    const bool valid = tree.isValidRBTree();
+    const double remove = nsPerOp(removals.size(), [&] {
+        for (int64_t k : removals) tree.remove(k);
+    });
+    std::cout << std::setw(10) << name << std::setw(10) << insert << std::setw(10) << lookup
+              << std::setw(10) << remove << std::setw(8) << sizeof(typename Tree::Node)
+              << (valid && hits == keys.size() ? "" : "  INVALID") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t queries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000;
+
+    std::mt19937 gen(42);
+    std::vector<int64_t> keys(count);
+    for (size_t i = 0; i < count; i++) keys[i] = static_cast<int64_t>(i);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    std::vector<int64_t> removals = keys;
+    std::shuffle(removals.begin(), removals.end(), gen);
+
+    std::cout << "Keys: " << count << "  (ns per operation, lower is better)" << std::endl;
+    std::cout << std::setw(10) << "summary" << std::setw(10) << "insert" << std::setw(10) << "lookup"
+              << std::setw(10) << "remove" << std::setw(8) << "node B" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    runUpdates<rbtree::RedBlackTree<int64_t>>("none", keys, removals);
+    runUpdates<rbtree::RedBlackTree<int64_t, rbtree::CountAugment<int64_t>>>("count", keys, removals);
+    runUpdates<rbtree::RedBlackTree<int64_t, rbtree::KeyStatsAugment<int64_t>>>("stats", keys, removals);
+
+    rbtree::RedBlackTree<int64_t, rbtree::KeyStatsAugment<int64_t>> tree;
+    for (int64_t k : keys) tree.insert(k);
+
+    std::cout << std::endl << "Range count+sum (ns per query)" << std::endl;
+    std::cout << std::setw(10) << "width" << std::setw(14) << "aggregate" << std::setw(14) << "scan"
+              << std::setw(10) << "speedup" << std::endl;
+    bool ok = true;
+    for (size_t width : {size_t(10), size_t(1000), count / 10, count}) {
+        std::uniform_int_distribution<int64_t> start(0, static_cast<int64_t>(count - std::min(width, count)));
+        std::vector<int64_t> froms(queries);
+        for (auto& f : froms) f = start(gen);
+
+        __int128 indexedSum = 0, scannedSum = 0;
+        const double indexed = nsPerOp(queries, [&] {
+            for (int64_t from : froms) {
+                const int64_t to = from + static_cast<int64_t>(width) - 1;
+                auto stats = tree.aggregate(from, to);
+                indexedSum += stats.sum + stats.count;
+            }
+        });
+        // Whole-tree scans are slow, so the scan side runs fewer queries
+        const size_t scanQueries = std::max<size_t>(1, std::min(queries, 20000000 / std::max<size_t>(count, 1)));
+        const double scanned = nsPerOp(scanQueries, [&] {
+            for (size_t q = 0; q < scanQueries; q++) {
+                const int64_t from = froms[q];
+                const int64_t to = from + static_cast<int64_t>(width) - 1;
+                __int128 sum = 0;
+                size_t n = 0;
+                tree.inorder([&](int64_t k) {
+                    if (k >= from && k <= to) {
+                        sum += k;
+                        n++;
+                    }
+                });
+                scannedSum += sum + n;
+            }
+        });
+        // The first scanQueries answers must match
+        __int128 check = 0;
+        for (size_t q = 0; q < scanQueries; q++) {
+            auto stats = tree.aggregate(froms[q], froms[q] + static_cast<int64_t>(width) - 1);
+            check += stats.sum + stats.count;
+        }
+        ok = ok && check == scannedSum && indexedSum != 0;
+        std::cout << std::setw(10) << width << std::setw(14) << indexed << std::setw(14) << scanned
+                  << std::setw(9) << scanned / indexed << "x" << std::endl;
+    }
+    if (!ok) {
+        std::cout << "MISMATCH between aggregate() and the scan" << std::endl;
+        return 1;
+    }
+    return 0;
+}
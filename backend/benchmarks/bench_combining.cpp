@@ -0,0 +1,133 @@
+// Contended small mutations: one lock taken per operation against flat
+// combining (one thread applies each published batch, sorted by key).
+// Half the operations insert and half remove random keys, so the tree stays
+// near half the key range. Each caller tallies the result it gets back, and
+// every tree must end valid with exactly the size those results add up to.
+//
+// Usage: ./bench_combining [ops_per_run] [key_range] [max_threads]
+//        defaults: 2,000,000 ops, 1,000,000 keys, 64 threads
+#include "rbtree/flat_combining.h"
+#include "rbtree/tree.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct Op {
+    int64_t key;
+    bool insert;
+    bool changed = false;
+};
+
+using Tree = rbtree::RedBlackTree<int64_t>;
+
+static void applyOne(Tree& tree, Op& op) {
+    if (op.insert) {
+        op.changed = !tree.search(op.key);
+        if (op.changed) tree.insert(op.key);
+    } else {
+        op.changed = tree.remove(op.key);
+    }
+}
+
+static void fill(Tree& tree, int64_t keyRange) {
+    for (int64_t key = 0; key < keyRange; key += 2) tree.insert(key);
+}
+
+struct Result {
+    double mops;
+    uint64_t inserted;
+    uint64_t removed;
+};
+
+// Runs ops split across threads, each with its own key stream; step is the
+// per-operation path under test and fills in op.changed
+template<typename Step>
+static Result run(size_t threads, size_t ops, int64_t keyRange, Step&& step) {
+    std::atomic<uint64_t> inserted{0}, removed{0};
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(1000 + t);
+            std::uniform_int_distribution<int64_t> keys(0, keyRange - 1);
+            uint64_t ins = 0, rem = 0;
+            ready++;
+            while (!go.load()) std::this_thread::yield();
+            for (size_t i = t; i < ops; i += threads) {
+                Op op{keys(gen), (i & 1) == 0};
+                step(op);
+                (op.insert ? ins : rem) += op.changed;
+            }
+            inserted += ins;
+            removed += rem;
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& worker : workers) worker.join();
+    auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    return {ops / seconds / 1e6, inserted.load(), removed.load()};
+}
+
+int main(int argc, char** argv) {
+    const size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    const int64_t keyRange = argc > 2 ? std::strtoll(argv[2], nullptr, 10) : 1000000;
+    const size_t maxThreads = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    if (keyRange < 2 || ops == 0) {
+        std::cerr << "Need at least 2 keys and 1 op" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Ops per run: " << ops << "  key range: " << keyRange
+              << "  hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "mutex"
+              << std::setw(12) << "combining" << std::setw(10) << "speedup"
+              << std::setw(12) << "avg batch" << "   (Mops/s)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    bool allMatch = true;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        // Both built before either run, so neither starts on a churned heap
+        Tree locked, combined;
+        fill(locked, keyRange);
+        fill(combined, keyRange);
+        std::mutex mutex;
+        Result plain = run(threads, ops, keyRange, [&](Op& op) {
+            std::lock_guard<std::mutex> lock(mutex);
+            applyOne(locked, op);
+        });
+
+        rbtree::FlatCombiner<Op> combiner;
+        auto apply = [&combined](std::vector<Op*>& batch) {
+            std::sort(batch.begin(), batch.end(), [](const Op* a, const Op* b) { return a->key < b->key; });
+            for (Op* op : batch) applyOne(combined, *op);
+        };
+        Result flat = run(threads, ops, keyRange, [&](Op& op) {
+            combiner.execute(op, apply);
+        });
+
+        // Concurrent ops may land in any order, but never lost or doubled
+        const uint64_t start = (keyRange + 1) / 2;
+        auto consistent = [start](Tree& tree, const Result& result) {
+            return tree.isValidRBTree() && tree.size() == start + result.inserted - result.removed;
+        };
+        const bool match = consistent(locked, plain) && consistent(combined, flat);
+        allMatch = allMatch && match;
+        const double avgBatch = combiner.batches() ? double(combiner.ops()) / combiner.batches() : 0;
+        std::cout << std::setw(8) << threads << std::setw(12) << plain.mops
+                  << std::setw(12) << flat.mops << std::setw(9) << flat.mops / plain.mops << "x"
+                  << std::setw(12) << avgBatch << (match ? "" : "   INVALID") << std::endl;
+    }
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// Connection-scaling benchmark for a running rbtree_server.
+//
+// For each idle-connection count, opens that many keep-alive connections
+// that make one request and then sit idle (each pins a worker on the
+// threaded front end), then measures throughput and latency of a fixed
+// number of active clients hammering one endpoint.
+//
+// Usage: ./bench_connections [host] [port] [active_clients] [seconds] [path] [idle counts...]
+//        defaults: 127.0.0.1 8080 8 5 /api/tree/stats 0 100 1000 4000
+//
+// Run it once against RBT_FRONTEND=threaded and once against RBT_FRONTEND=epoll,
+// raising RBT_KEEPALIVE_MAX_COUNT / RBT_KEEPALIVE_TIMEOUT so idle clients stay.
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static int connectTo(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) return -1;
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval tv{10, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    return fd;
+}
+
+// Sends one GET and reads the full response. Returns false on any error;
+// `keepAlive` reports whether the server will keep the connection open.
+static bool roundTrip(int fd, const std::string& request, bool& keepAlive) {
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+
+    std::string buffer;
+    char chunk[16384];
+    size_t headerEnd = std::string::npos;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+
+    std::string headers = buffer.substr(0, headerEnd);
+    std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+    size_t length = 0;
+    size_t pos = headers.find("content-length:");
+    if (pos != std::string::npos) length = std::strtoull(headers.c_str() + pos + 15, nullptr, 10);
+    keepAlive = headers.find("connection: close") == std::string::npos;
+
+    while (buffer.size() - (headerEnd + 4) < length) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+    return headers.compare(0, 12, "http/1.1 200") == 0;
+}
+
+int main(int argc, char** argv) {
+    const std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    const int port = argc > 2 ? std::atoi(argv[2]) : 8080;
+    const int active = argc > 3 ? std::atoi(argv[3]) : 8;
+    const double seconds = argc > 4 ? std::atof(argv[4]) : 5.0;
+    const std::string path = argc > 5 ? argv[5] : "/api/tree/stats";
+    std::vector<int> idleCounts;
+    for (int i = 6; i < argc; i++) idleCounts.push_back(std::atoi(argv[i]));
+    if (idleCounts.empty()) idleCounts = {0, 100, 1000, 4000};
+
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\n\r\n";
+
+    std::cout << "Target: " << host << ":" << port << path << "  active clients: " << active
+              << "  duration: " << seconds << "s" << std::endl;
+    std::cout << std::setw(8) << "idle" << std::setw(10) << "opened" << std::setw(12) << "req/s"
+              << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms"
+              << std::setw(10) << "errors" << std::endl;
+
+    for (int idleCount : idleCounts) {
+        // Idle clients: one request each, then silence
+        std::vector<int> idle;
+        for (int i = 0; i < idleCount; i++) {
+            int fd = connectTo(host, port);
+            if (fd < 0) break;
+            // The response is left unread on purpose so that opening
+            // thousands of connections stays fast
+            send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+            idle.push_back(fd);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        std::atomic<bool> stop{false};
+        std::atomic<long> errors{0};
+        std::vector<std::vector<double>> latencies(active);
+        std::vector<std::thread> clients;
+        for (int c = 0; c < active; c++) {
+            clients.emplace_back([&, c] {
+                int fd = -1;
+                while (!stop) {
+                    if (fd < 0 && (fd = connectTo(host, port)) < 0) {
+                        errors++;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        continue;
+                    }
+                    bool keepAlive = false;
+                    auto start = Clock::now();
+                    bool ok = roundTrip(fd, request, keepAlive);
+                    auto end = Clock::now();
+                    if (ok) {
+                        latencies[c].push_back(std::chrono::duration<double, std::milli>(end - start).count());
+                    } else {
+                        errors++;
+                    }
+                    if (!ok || !keepAlive) {
+                        close(fd);
+                        fd = -1;
+                    }
+                }
+                if (fd >= 0) close(fd);
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for (auto& t : clients) t.join();
+
+        std::vector<double> all;
+        for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+        std::sort(all.begin(), all.end());
+        auto pct = [&all](double p) {
+            return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))];
+        };
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << idleCount << std::setw(10) << idle.size()
+                  << std::setw(12) << std::setprecision(0) << all.size() / seconds
+                  << std::setprecision(2) << std::setw(10) << pct(0.50) << std::setw(10) << pct(0.99)
+                  << std::setw(10) << (all.empty() ? 0.0 : all.back())
+                  << std::setw(10) << errors.load() << std::endl;
+
+        for (int fd : idle) close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    return 0;
+}
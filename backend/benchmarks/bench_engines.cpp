@@ -0,0 +1,111 @@
+// Runs the same workloads on every ordered-index engine through the
+// OrderedIndex interface TreeAPI uses, so virtual dispatch costs the same for
+// all of them and only the data structure differs.
+//
+// Workloads, in order, on one index per engine:
+//   insert    N distinct keys in random order
+//   lookup    N searches, half hits and half misses
+//   read-95   N operations: 95% lookups, 5% insert/remove pairs
+//   scan      in-order visit of every key
+//   remove    every key in a fresh random order
+//
+// Usage: ./bench_engines [key_count] [engines...]
+//        defaults: 1,000,000 keys, every engine
+#include "rbtree/ordered_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+template<typename F>
+static double nsPerOp(size_t ops, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / std::max<size_t>(ops, 1);
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::vector<std::string> engines;
+    for (int i = 2; i < argc; i++) engines.push_back(argv[i]);
+    if (engines.empty()) engines = rbtree::indexEngines();
+
+    // Even keys are present, odd keys are misses
+    std::mt19937 gen(42);
+    std::vector<int> keys(count);
+    for (size_t i = 0; i < count; i++) keys[i] = static_cast<int>(2 * i);
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    std::vector<int> probes(count);
+    std::uniform_int_distribution<size_t> pick(0, count - 1);
+    for (size_t i = 0; i < count; i++) probes[i] = keys[pick(gen)] + static_cast<int>(i & 1);
+
+    std::vector<int> removals = keys;
+    std::shuffle(removals.begin(), removals.end(), gen);
+
+    std::cout << "Keys: " << count << "  (ns per operation, lower is better)" << std::endl;
+    std::cout << std::setw(8) << "engine" << std::setw(10) << "insert" << std::setw(10) << "lookup"
+              << std::setw(10) << "read-95" << std::setw(10) << "scan" << std::setw(10) << "remove"
+              << std::setw(8) << "height" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    bool ok = true;
+    for (const auto& name : engines) {
+        auto index = rbtree::makeOrderedIndex<int>(name);
+        if (!index) {
+            std::cerr << "Unknown engine '" << name << "'" << std::endl;
+            return 1;
+        }
+
+        const double insert = nsPerOp(count, [&] {
+            for (int k : keys) index->insert(k);
+        });
+        const int height = index->height();
+
+        size_t hits = 0;
+        const double lookup = nsPerOp(count, [&] {
+            for (int k : probes) hits += index->contains(k);
+        });
+        const bool lookupsRight = hits == (count + 1) / 2;
+
+        // Every 20th operation inserts a missing odd key and removes it again
+        // on the next, so the tree size stays at N
+        const double mixed = nsPerOp(count, [&] {
+            for (size_t i = 0; i < count; i++) {
+                const int k = probes[i];
+                if (i % 20 == 0 && i + 1 < count) {
+                    index->insert(k | 1);
+                } else if (i % 20 == 1) {
+                    index->remove(probes[i - 1] | 1);
+                } else {
+                    index->contains(k);
+                }
+            }
+        });
+
+        int64_t sum = 0;
+        const double scan = nsPerOp(count, [&] {
+            index->forEach([&sum](const int& k) { sum += k; });
+        });
+
+        const int64_t expectedSum = static_cast<int64_t>(count) * (static_cast<int64_t>(count) - 1);
+        const bool valid = lookupsRight && sum == expectedSum && index->validate() &&
+                           index->size() == count;
+        const double remove = nsPerOp(count, [&] {
+            for (int k : removals) index->remove(k);
+        });
+        ok = ok && valid && index->empty();
+
+        std::cout << std::setw(8) << name << std::setw(10) << insert << std::setw(10) << lookup
+                  << std::setw(10) << mixed << std::setw(10) << scan << std::setw(10) << remove
+                  << std::setw(8) << height << (valid ? "" : "   INVALID") << std::endl;
+    }
+    return ok ? 0 : 1;
+}
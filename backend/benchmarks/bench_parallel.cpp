@@ -0,0 +1,78 @@
+// Scaling of the fork-join whole-tree passes with thread count. Every
+// parallel result is checked against the sequential call.
+//
+// Usage: ./bench_parallel [node_count] [cutoff_depth] [max_threads]
+//        defaults: 10,000,000 nodes, cutoff 8, 2 x hardware threads
+#include "rbtree/tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+template<typename F>
+static double timeMs(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const int cutoff = argc > 2 ? std::atoi(argv[2]) : 8;
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    const size_t maxThreads = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 2 * hw;
+
+    std::vector<int> keys(count);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    rbtree::RedBlackTree<int> tree;
+    for (int key : keys) tree.insert(key);
+    std::vector<int>().swap(keys);
+    tree.updateLayout();
+
+    int height = 0;
+    bool valid = false;
+    std::vector<rbtree::RBNode<int>*> nodes;
+    std::string json;
+    const double seqHeight = timeMs([&] { height = tree.height(); });
+    const double seqValid = timeMs([&] { valid = tree.isValidRBTree(); });
+    const double seqNodes = timeMs([&] { nodes = tree.getAllNodes(); });
+    const double seqJson = timeMs([&] { json = tree.toJSON(); });
+
+    std::cout << "Nodes: " << tree.size() << "  cutoff depth: " << cutoff
+              << "  hardware threads: " << hw << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "height"
+              << std::setw(12) << "validate" << std::setw(12) << "nodes"
+              << std::setw(12) << "toJSON" << "   (ms)" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(8) << "seq" << std::setw(12) << seqHeight
+              << std::setw(12) << seqValid << std::setw(12) << seqNodes
+              << std::setw(12) << seqJson << std::endl;
+
+    bool allMatch = true;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        rbtree::WorkStealingPool pool(threads);
+        int h = 0;
+        bool v = false;
+        std::vector<rbtree::RBNode<int>*> n;
+        std::string j;
+        const double tHeight = timeMs([&] { h = tree.height(pool, cutoff); });
+        const double tValid = timeMs([&] { v = tree.isValidRBTree(pool, cutoff); });
+        const double tNodes = timeMs([&] { n = tree.getAllNodes(pool, cutoff); });
+        const double tJson = timeMs([&] { j = tree.toJSON(pool, cutoff); });
+        const bool match = h == height && v == valid && n == nodes && j == json;
+        allMatch = allMatch && match;
+        std::cout << std::setw(8) << threads << std::setw(12) << tHeight
+                  << std::setw(12) << tValid << std::setw(12) << tNodes
+                  << std::setw(12) << tJson << (match ? "" : "   MISMATCH") << std::endl;
+    }
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// std::string keys vs rbtree::StringKey (inline 8-byte prefix) on every
+// engine, over key sets shaped like real ids.
+//
+//   uuid    36-char random v4 UUIDs: the prefix almost always decides
+//   email   first.last<n>@domain: a few hundred names, so prefixes collide
+//           in clusters and some comparisons reach the heap
+//   sku     "SKU-" + 6 digits: short enough for SSO, prefix decides half
+//   url     "/api/v1/users/<id>/orders": 14 shared leading bytes, so the
+//           prefix never decides; this is the worst case for StringKey
+//
+// Usage: ./bench_string_keys [key_count] [key sets...]
+//        defaults: 500,000 keys, every key set
+#include "rbtree/ordered_index.h"
+#include "rbtree/string_key.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+template<typename F>
+static double nsPerOp(size_t ops, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / std::max<size_t>(ops, 1);
+}
+
+static std::vector<std::string> makeKeys(const std::string& set, size_t count, std::mt19937_64& gen) {
+    static const char* firstNames[] = {"james", "mary", "robert", "patricia", "john", "jennifer",
+                                       "michael", "linda", "christopher", "elizabeth", "william",
+                                       "barbara", "alexander", "jessica", "maximilian", "sarah"};
+    static const char* lastNames[] = {"smith", "johnson", "williams", "brown", "jones", "garcia",
+                                      "miller", "davis", "rodriguez", "martinez", "hernandez",
+                                      "lopez", "gonzalez", "wilson", "anderson", "thompson"};
+    static const char* domains[] = {"gmail.com", "yahoo.com", "outlook.com", "example.org"};
+
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    char buffer[128];
+    for (size_t i = 0; i < count; i++) {
+        const uint64_t r = gen();
+        if (set == "uuid") {
+            const uint64_t r2 = gen();
+            std::snprintf(buffer, sizeof(buffer), "%08x-%04x-4%03x-%04x-%012llx",
+                          static_cast<unsigned>(r >> 32), static_cast<unsigned>(r >> 16) & 0xffff,
+                          static_cast<unsigned>(r) & 0xfff, 0x8000 | (static_cast<unsigned>(r2 >> 48) & 0x3fff),
+                          static_cast<unsigned long long>(r2 & 0xffffffffffffULL));
+        } else if (set == "email") {
+            std::snprintf(buffer, sizeof(buffer), "%s.%s%zu@%s", firstNames[r % 16], lastNames[(r >> 8) % 16],
+                          i, domains[(r >> 16) % 4]);
+        } else if (set == "sku") {
+            std::snprintf(buffer, sizeof(buffer), "SKU-%06zu", i);
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "/api/v1/users/%zu/orders", i);
+        }
+        keys.emplace_back(buffer);
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+    return keys;
+}
+
+template<typename Key>
+static void run(const std::string& engine, const std::vector<std::string>& strings,
+                const std::vector<std::string>& probes, double& insert, double& lookup, bool& ok) {
+    // Keys are built before timing so both types pay only for the tree work
+    std::vector<Key> keys(strings.begin(), strings.end());
+    std::vector<Key> lookups(probes.begin(), probes.end());
+    auto index = rbtree::makeOrderedIndex<Key>(engine);
+
+    insert = nsPerOp(keys.size(), [&] {
+        for (const Key& k : keys) index->insert(k);
+    });
+    size_t hits = 0;
+    lookup = nsPerOp(lookups.size(), [&] {
+        for (const Key& k : lookups) hits += index->contains(k);
+    });
+    ok = ok && hits == (lookups.size() + 1) / 2 && index->size() == keys.size();
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500000;
+    std::vector<std::string> sets;
+    for (int i = 2; i < argc; i++) sets.push_back(argv[i]);
+    if (sets.empty()) sets = {"uuid", "email", "sku", "url"};
+
+    std::cout << "Keys: " << count << "  (ns per operation, lower is better)" << std::endl;
+    std::cout << std::setw(7) << "keys" << std::setw(8) << "engine"
+              << std::setw(14) << "insert str" << std::setw(14) << "insert pfx"
+              << std::setw(14) << "lookup str" << std::setw(14) << "lookup pfx" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    bool ok = true;
+    for (const auto& set : sets) {
+        std::mt19937_64 gen(42);
+        // Half of the probes are present keys, half are from a disjoint
+        // batch of the same shape
+        std::vector<std::string> all = makeKeys(set, count * 2, gen);
+        std::vector<std::string> keys(all.begin(), all.begin() + count);
+        std::vector<std::string> probes(count);
+        std::uniform_int_distribution<size_t> pick(0, count - 1);
+        for (size_t i = 0; i < count; i++) probes[i] = all[pick(gen) + (i & 1 ? count : 0)];
+
+        for (const auto& engine : rbtree::indexEngines()) {
+            double insertStr = 0, lookupStr = 0, insertPfx = 0, lookupPfx = 0;
+            run<std::string>(engine, keys, probes, insertStr, lookupStr, ok);
+            run<rbtree::StringKey>(engine, keys, probes, insertPfx, lookupPfx, ok);
+            std::cout << std::setw(7) << set << std::setw(8) << engine
+                      << std::setw(14) << insertStr << std::setw(14) << insertPfx
+                      << std::setw(14) << lookupStr << std::setw(14) << lookupPfx << std::endl;
+        }
+    }
+    if (!ok) std::cerr << "MISMATCH: lookups or sizes differ from the key set" << std::endl;
+    return ok ? 0 : 1;
+}
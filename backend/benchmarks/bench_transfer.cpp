@@ -0,0 +1,88 @@
+// Moving keys between red-black trees: copy versus node handles.
+//
+// Every key of one tree moves into a second tree that already holds an
+// interleaved half of the key space, three ways:
+//   copy      search + insert(copy) + remove, a node freed and one allocated
+//   handle    extract + insert(node_handle&&), the node relinked
+//   merge     merge(other), every node spliced in one call
+// String keys longer than the small-string buffer make each copy allocate.
+//
+// Usage: ./bench_transfer [key_count]
+//        defaults: 200,000 keys per tree
+#include "rbtree/tree.h"
+#include "rbtree/string_key.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using Tree = rbtree::RedBlackTree<rbtree::StringKey>;
+
+static std::string makeKey(size_t i) {
+    // Long enough to live on the heap
+    return "archive/2024/customer-" + std::to_string(1000000000 + i) + "/orders";
+}
+
+static void fill(Tree& source, Tree& target, const std::vector<std::string>& keys) {
+    for (size_t i = 0; i < keys.size(); i++) {
+        (i % 2 ? target : source).insert(rbtree::StringKey(keys[i]));
+    }
+}
+
+template<typename F>
+static double msFor(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    std::vector<std::string> keys(2 * count);
+    for (size_t i = 0; i < keys.size(); i++) keys[i] = makeKey(i);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    // The source's keys, in the order each method moves them
+    std::vector<rbtree::StringKey> moving;
+    for (size_t i = 0; i < keys.size(); i += 2) moving.emplace_back(keys[i]);
+
+    std::cout << "Moving " << count << " string keys into a tree of " << count << std::endl;
+    std::cout << std::setw(8) << "method" << std::setw(12) << "total ms" << std::setw(12) << "ns/key" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    auto report = [count](const char* name, double ms, const Tree& source, const Tree& target) {
+        const bool ok = source.empty() && target.size() == 2 * count && target.isValidRBTree();
+        std::cout << std::setw(8) << name << std::setw(12) << ms << std::setw(12) << ms * 1e6 / count
+                  << (ok ? "" : "  INVALID") << std::endl;
+        return ok;
+    };
+
+    // All three pairs are built before anything is timed, so no method
+    // runs on a heap the previous one left behind
+    Tree copySource, copyTarget, handleSource, handleTarget, mergeSource, mergeTarget;
+    fill(copySource, copyTarget, keys);
+    fill(handleSource, handleTarget, keys);
+    fill(mergeSource, mergeTarget, keys);
+
+    bool ok = true;
+    double ms = msFor([&] {
+        for (const auto& key : moving) {
+            copyTarget.insert(key);
+            copySource.remove(key);
+        }
+    });
+    ok = report("copy", ms, copySource, copyTarget) && ok;
+
+    ms = msFor([&] {
+        for (const auto& key : moving) handleTarget.insert(handleSource.extract(key));
+    });
+    ok = report("handle", ms, handleSource, handleTarget) && ok;
+
+    ms = msFor([&] { mergeTarget.merge(mergeSource); });
+    ok = report("merge", ms, mergeSource, mergeTarget) && ok;
+    return ok ? 0 : 1;
+}
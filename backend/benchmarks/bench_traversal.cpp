@@ -0,0 +1,215 @@
+// Compares the iterative traversal kernels in rbtree/traversal.h against the
+// recursive helpers they replaced. The recursive versions are kept here,
+// verbatim apart from operating on raw nodes, as the reference.
+//
+// Usage: ./bench_traversal [node_count]   (default 10,000,000)
+#include "rbtree/tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Node = rbtree::RBNode<int>;
+
+namespace recursive {
+
+int heightHelper(Node* node, Node* NIL) {
+    if (node == NIL) return 0;
+    return 1 + std::max(heightHelper(node->left, NIL), heightHelper(node->right, NIL));
+}
+
+void collectNodes(Node* node, Node* NIL, std::vector<Node*>& nodes) {
+    if (node != NIL) {
+        nodes.push_back(node);
+        collectNodes(node->left, NIL, nodes);
+        collectNodes(node->right, NIL, nodes);
+    }
+}
+
+void calculatePositions(Node* node, Node* NIL, int level, int& position) {
+    if (node == NIL) return;
+    calculatePositions(node->left, NIL, level + 1, position);
+    node->x = position * 80;
+    node->y = level * 100;
+    node->level = level;
+    position++;
+    calculatePositions(node->right, NIL, level + 1, position);
+}
+
+void inorderHelper(Node* node, Node* NIL, std::function<void(const int&)> visit) {
+    if (node != NIL) {
+        inorderHelper(node->left, NIL, visit);
+        visit(node->data);
+        inorderHelper(node->right, NIL, visit);
+    }
+}
+
+std::string nodeToJSON(Node* node, Node* NIL) {
+    if (node == NIL) return "null";
+    std::ostringstream oss;
+    oss << "{";
+    oss << "\"data\":" << node->data << ",";
+    oss << "\"color\":\"" << (node->isRed ? "red" : "black") << "\",";
+    oss << "\"x\":" << node->x << ",";
+    oss << "\"y\":" << node->y << ",";
+    oss << "\"left\":" << nodeToJSON(node->left, NIL) << ",";
+    oss << "\"right\":" << nodeToJSON(node->right, NIL);
+    oss << "}";
+    return oss.str();
+}
+
+bool validateNode(Node* node, Node* NIL, int blackCount, int& blackHeight) {
+    if (node == NIL) {
+        if (blackHeight == -1) blackHeight = blackCount;
+        return blackHeight == blackCount;
+    }
+    if (node->isRed) {
+        if ((node->left != NIL && node->left->isRed) ||
+            (node->right != NIL && node->right->isRed)) {
+            return false;
+        }
+    }
+    if (!node->isRed) blackCount++;
+    return validateNode(node->left, NIL, blackCount, blackHeight) &&
+           validateNode(node->right, NIL, blackCount, blackHeight);
+}
+
+void clearHelper(Node* node, Node* NIL) {
+    if (node != NIL) {
+        clearHelper(node->left, NIL);
+        clearHelper(node->right, NIL);
+        delete node;
+    }
+}
+
+} // namespace recursive
+
+// Copies the shape of a subtree so both clear() variants free identical trees.
+static Node* cloneTree(Node* node, Node* NIL, Node* parent) {
+    if (node == NIL) return NIL;
+    Node* copy = new Node(node->data, node->isRed);
+    copy->parent = parent;
+    copy->left = cloneTree(node->left, NIL, copy);
+    copy->right = cloneTree(node->right, NIL, copy);
+    return copy;
+}
+
+template<typename F>
+static double timeMs(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Alternates the two variants and keeps the best of each, so neither side
+// is charged for a cold cache or a freshly fragmented heap.
+static const int kRounds = 5;
+
+template<typename R, typename I>
+static void race(double& recursiveMs, double& iterativeMs, R&& rec, I&& iter) {
+    recursiveMs = iterativeMs = 1e300;
+    rec();
+    iter();
+    for (int round = 0; round < kRounds; round++) {
+        recursiveMs = std::min(recursiveMs, timeMs(rec));
+        iterativeMs = std::min(iterativeMs, timeMs(iter));
+    }
+}
+
+static void report(const char* name, double recursiveMs, double iterativeMs, bool same) {
+    std::cout << std::left << std::setw(14) << name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << recursiveMs
+              << std::setw(12) << iterativeMs
+              << std::setw(9) << std::setprecision(2) << (recursiveMs / iterativeMs) << "x"
+              << (same ? "" : "   MISMATCH") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    std::vector<int> keys(count);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    rbtree::RedBlackTree<int> tree;
+    double buildMs = timeMs([&] {
+        for (int key : keys) tree.insert(key);
+    });
+    std::vector<int>().swap(keys);
+
+    Node* root = tree.getRoot();
+    Node* NIL = tree.getNIL();
+    std::cout << "Nodes: " << tree.size() << "  (built in " << std::fixed
+              << std::setprecision(1) << buildMs << " ms)" << std::endl;
+    std::cout << std::left << std::setw(14) << "operation" << std::right
+              << std::setw(12) << "recursive" << std::setw(12) << "iterative"
+              << std::setw(10) << "speedup" << std::endl;
+
+    double r = 0, i = 0;
+    {
+        int a = 0, b = 0;
+        race(r, i, [&] { a = recursive::heightHelper(root, NIL); },
+                   [&] { b = tree.height(); });
+        report("height", r, i, a == b);
+    }
+    {
+        bool a = false, b = false;
+        race(r, i, [&] { int bh = -1; a = recursive::validateNode(root, NIL, 0, bh); },
+                   [&] { b = tree.isValidRBTree(); });
+        report("validate", r, i, a == b);
+    }
+    {
+        std::vector<Node*> a, b;
+        race(r, i, [&] { a.clear(); recursive::collectNodes(root, NIL, a); },
+                   [&] { b = tree.getAllNodes(); });
+        report("getAllNodes", r, i, a == b);
+    }
+    {
+        long long a = 0, b = 0;
+        race(r, i, [&] { a = 0; recursive::inorderHelper(root, NIL, [&a](const int& v) { a += v; }); },
+                   [&] { b = 0; tree.inorder([&b](const int& v) { b += v; }); });
+        report("inorder", r, i, a == b);
+    }
+    {
+        int position = 0;
+        race(r, i, [&] { position = 0; recursive::calculatePositions(root, NIL, 0, position); },
+                   [&] { tree.updateLayout(); });
+        report("layout", r, i, position == static_cast<int>(tree.size()));
+    }
+    {
+        std::string a, b;
+        race(r, i, [&] { a = recursive::nodeToJSON(root, NIL); },
+                   [&] { b = tree.toJSON(); });
+        report("toJSON", r, i, a == b);
+    }
+    {
+        struct Deleter : rbtree::TraversalVisitor {
+            void post(Node* n) { delete n; }
+        } deleter;
+        Node* copy = nullptr;
+        r = i = 1e300;
+        // The first clone gets a pristine heap and later ones a recycled
+        // one, so discard a warm-up round and alternate the variants.
+        copy = cloneTree(root, NIL, nullptr);
+        rbtree::eulerTour(copy, NIL, deleter);
+        for (int round = 0; round < 2 * kRounds; round++) {
+            copy = cloneTree(root, NIL, nullptr);
+            if (round % 2 == 0) {
+                r = std::min(r, timeMs([&] { recursive::clearHelper(copy, NIL); }));
+            } else {
+                i = std::min(i, timeMs([&] { rbtree::eulerTour(copy, NIL, deleter); }));
+            }
+        }
+        report("clear", r, i, true);
+    }
+    return 0;
+}
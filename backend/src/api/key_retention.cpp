@@ -0,0 +1,177 @@
+#include "key_retention.h"
+#include "../rbtree/string_key.h"
+#include <algorithm>
+
+template<typename Key>
+KeyRetention<Key>::KeyRetention(const RetentionConfig& config, Clock::time_point start)
+    : config_(config), start_(start), trackAll_(config.memoryCapBytes > 0), wheel_(kWheelSlots) {}
+
+template<typename Key>
+uint64_t KeyRetention<Key>::tickAt(Clock::time_point t) const {
+    if (t <= start_) return 0;
+    return static_cast<uint64_t>((t - start_) / config_.tick);
+}
+
+template<typename Key>
+void KeyRetention<Key>::schedule(const Key& key, Entry& entry, std::chrono::milliseconds ttl,
+                                 Clock::time_point now) {
+    if (pending_.load(std::memory_order_relaxed) == 0) {
+        // Nothing is filed, so the sweep can skip straight to the present
+        wheelTick_ = std::max(wheelTick_, tickAt(now));
+    }
+    // Rounded up, so a key never expires early
+    entry.deadline = std::max(tickAt(now + ttl + config_.tick - std::chrono::milliseconds(1)), wheelTick_ + 1);
+    wheel_[entry.deadline % kWheelSlots].push_back({key, entry.deadline});
+    pending_.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename Key>
+void KeyRetention<Key>::added(const Key& key, size_t bytes, std::chrono::milliseconds ttl,
+                              Clock::time_point now) {
+    if (ttl < std::chrono::milliseconds(0)) ttl = config_.defaultTtl;
+    if (!trackAll_ && ttl.count() == 0) return;
+
+    auto inserted = entries_.try_emplace(key);
+    Entry& entry = inserted.first->second;
+    if (inserted.second) {
+        entry.bytes = bytes;
+        bytes_ += bytes;
+        if (trackAll_) {
+            entry.sequence = nextSequence_++;
+            queue_.push_back({key, entry.sequence});
+        }
+    }
+    entry.deadline = 0;
+    if (ttl.count() > 0) schedule(key, entry, ttl, now);
+}
+
+template<typename Key>
+void KeyRetention<Key>::refreshed(const Key& key, std::chrono::milliseconds ttl, Clock::time_point now) {
+    if (ttl < std::chrono::milliseconds(0)) return;
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        // Untracked until now; its footprint only matters under a cap, and
+        // then every key is already tracked
+        if (ttl.count() > 0) added(key, 0, ttl, now);
+        return;
+    }
+    if (ttl.count() == 0 && !trackAll_) {
+        forget(it);
+        return;
+    }
+    it->second.deadline = 0;
+    if (ttl.count() > 0) schedule(key, it->second, ttl, now);
+}
+
+template<typename Key>
+void KeyRetention<Key>::forget(typename Entries::iterator it) {
+    bytes_ -= it->second.bytes;
+    entries_.erase(it);
+}
+
+template<typename Key>
+void KeyRetention<Key>::removed(const Key& key) {
+    if (entries_.empty()) return;
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return;
+    forget(it);
+    if (queue_.size() > 2 * entries_.size() + 1024) compactQueue();
+}
+
+template<typename Key>
+void KeyRetention<Key>::compactQueue() {
+    // Drop slots whose key was deleted or requeued since
+    std::deque<Queued> live;
+    for (auto& slot : queue_) {
+        auto it = entries_.find(slot.key);
+        if (it != entries_.end() && it->second.sequence == slot.sequence) live.push_back(std::move(slot));
+    }
+    queue_.swap(live);
+}
+
+template<typename Key>
+void KeyRetention<Key>::cleared() {
+    entries_.clear();
+    for (auto& slot : wheel_) slot.clear();
+    due_.clear();
+    queue_.clear();
+    pending_.store(0, std::memory_order_relaxed);
+    bytes_ = 0;
+}
+
+template<typename Key>
+void KeyRetention<Key>::touched(const Key& key) const {
+    if (!trackAll_ || config_.eviction != EvictionPolicy::Lru) return;
+    auto it = entries_.find(key);
+    if (it != entries_.end()) it->second.referenced.store(true, std::memory_order_relaxed);
+}
+
+template<typename Key>
+void KeyRetention<Key>::sweepSlot() {
+    auto& slot = wheel_[++wheelTick_ % kWheelSlots];
+    size_t kept = 0;
+    for (auto& timer : slot) {
+        if (timer.deadline > wheelTick_) {
+            slot[kept++] = std::move(timer);  // a later lap
+            continue;
+        }
+        auto it = entries_.find(timer.key);
+        if (it != entries_.end() && it->second.deadline == timer.deadline) {
+            due_.push_back(std::move(timer.key));
+        } else {
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    slot.resize(kept);
+}
+
+template<typename Key>
+size_t KeyRetention<Key>::expire(Clock::time_point now, const Remove& remove) {
+    const uint64_t nowTick = tickAt(now);
+    const size_t batch = std::max<size_t>(config_.expireBatch, 1);
+    size_t removed = 0;
+    while (removed < batch) {
+        if (due_.empty()) {
+            if (wheelTick_ >= nowTick) break;
+            sweepSlot();
+            continue;
+        }
+        Key key = std::move(due_.front());
+        due_.pop_front();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        // Deleted or given a new deadline since it fired
+        auto it = entries_.find(key);
+        if (it == entries_.end() || it->second.deadline == 0 || it->second.deadline > nowTick) continue;
+        forget(it);
+        remove(key);
+        removed++;
+    }
+    expired_ += removed;
+    return removed;
+}
+
+template<typename Key>
+size_t KeyRetention<Key>::evict(const Remove& remove) {
+    if (!trackAll_) return 0;
+    size_t removed = 0;
+    while (bytes_ > config_.memoryCapBytes && !queue_.empty()) {
+        Queued slot = std::move(queue_.front());
+        queue_.pop_front();
+        auto it = entries_.find(slot.key);
+        if (it == entries_.end() || it->second.sequence != slot.sequence) continue;
+        if (config_.eviction == EvictionPolicy::Lru &&
+            it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+            it->second.sequence = nextSequence_++;
+            queue_.push_back({std::move(slot.key), it->second.sequence});
+            continue;
+        }
+        forget(it);
+        remove(slot.key);
+        removed++;
+    }
+    evicted_ += removed;
+    return removed;
+}
+
+template class KeyRetention<int64_t>;
+template class KeyRetention<rbtree::StringKey>;
@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Which keys go first once the memory cap is reached
+enum class EvictionPolicy { Lru, Oldest };
+
+struct RetentionConfig {
+    std::chrono::milliseconds defaultTtl{0};   // 0 = keys live until deleted
+    size_t memoryCapBytes = 0;                 // 0 = unbounded
+    EvictionPolicy eviction = EvictionPolicy::Lru;
+    std::chrono::milliseconds tick{100};       // timer wheel resolution
+    size_t expireBatch = 1024;                 // keys removed per lock hold
+};
+
+// Per-key TTLs and a memory cap for TreeAPI's index. Not thread-safe: the
+// caller holds the tree's exclusive lock for everything except touched(),
+// which only needs the shared one, and pending().
+//
+// Expiry uses a hashed timer wheel of kWheelSlots slots, `tick` apart. A
+// key's timer sits in the slot of its deadline tick, and deadlines more
+// than a lap out are skipped until their lap comes round. Deleting a key or
+// restarting its TTL leaves the old timer behind; it is dropped when its
+// slot comes up and no longer matches the key's deadline.
+//
+// Eviction queues tracked keys in insertion order. Oldest evicts from the
+// front. Lru gives a key that was read since it was queued a second chance
+// at the back (CLOCK), which approximates LRU while letting reads mark keys
+// under the shared lock.
+template<typename Key>
+class KeyRetention {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Remove = std::function<void(const Key&)>;
+
+    // Passed as a ttl to mean "the configured default"
+    static constexpr std::chrono::milliseconds kDefaultTtl{-1};
+    static constexpr size_t kWheelSlots = 4096;
+
+    explicit KeyRetention(const RetentionConfig& config, Clock::time_point start = Clock::now());
+
+    const RetentionConfig& config() const { return config_; }
+
+    // A key new to the index, with its estimated footprint there. A ttl of
+    // zero never expires.
+    void added(const Key& key, size_t bytes, std::chrono::milliseconds ttl, Clock::time_point now);
+    // A key inserted again with an explicit ttl: its clock restarts
+    void refreshed(const Key& key, std::chrono::milliseconds ttl, Clock::time_point now);
+    void removed(const Key& key);
+    void cleared();
+    // A read hit; only Lru cares
+    void touched(const Key& key) const;
+
+    // Removes up to config().expireBatch keys whose deadline has passed,
+    // calling remove for each. Returns how many went; fewer than a batch
+    // means nothing else is due at `now`.
+    size_t expire(Clock::time_point now, const Remove& remove);
+    // Removes keys until the footprint is within the cap. Returns how many went.
+    size_t evict(const Remove& remove);
+
+    // Timers not yet fired or discarded; safe to read without the lock
+    size_t pending() const { return pending_.load(std::memory_order_relaxed); }
+    size_t tracked() const { return entries_.size(); }
+    size_t bytes() const { return bytes_; }
+    uint64_t expiredTotal() const { return expired_; }
+    uint64_t evictedTotal() const { return evicted_; }
+
+    // Bookkeeping per tracked key, excluding any heap data the key owns
+    static constexpr size_t overheadBytes();
+
+private:
+    struct Entry {
+        uint64_t deadline = 0;   // wheel tick, 0 = no TTL
+        uint64_t sequence = 0;   // matches the key's newest queue slot
+        size_t bytes = 0;
+        mutable std::atomic<bool> referenced{false};
+    };
+    struct Timer {
+        Key key;
+        uint64_t deadline;
+    };
+    struct Queued {
+        Key key;
+        uint64_t sequence;
+    };
+    using Entries = std::unordered_map<Key, Entry>;
+
+    uint64_t tickAt(Clock::time_point t) const;
+    void schedule(const Key& key, Entry& entry, std::chrono::milliseconds ttl, Clock::time_point now);
+    void forget(typename Entries::iterator it);
+    // Advances wheelTick_ by one, moving that slot's live timers to due_
+    void sweepSlot();
+    void compactQueue();
+
+    const RetentionConfig config_;
+    const Clock::time_point start_;
+    // A cap needs every key queued; TTLs alone only track keys that have one
+    const bool trackAll_;
+
+    Entries entries_;
+    std::vector<std::vector<Timer>> wheel_;
+    uint64_t wheelTick_ = 0;  // slots up to this tick have been swept
+    std::deque<Key> due_;     // fired, waiting for a batch
+    std::atomic<size_t> pending_{0};
+    std::deque<Queued> queue_;
+    uint64_t nextSequence_ = 1;
+    size_t bytes_ = 0;
+    uint64_t expired_ = 0;
+    uint64_t evicted_ = 0;
+};
+
+template<typename Key>
+constexpr size_t KeyRetention<Key>::overheadBytes() {
+    // Hash node (key, entry, next pointer, cached hash, malloc header) plus a
+    // bucket, and the eviction queue slot
+    return sizeof(Key) + sizeof(Entry) + 3 * sizeof(void*) + 16 + sizeof(Queued);
+}
@@ -0,0 +1,686 @@
+#include "replication.h"
+#include "../rbtree/string_key.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'R', 'B', 'T', 'R', 'E', 'P', 'L', '1'};
+
+enum FrameType : uint8_t {
+    kHello = 1,
+    kAck = 2,
+    kSnapshotBegin = 10,
+    kSnapshotKeys = 11,
+    kSnapshotEnd = 12,
+    kCommit = 13,
+    kHeartbeat = 14,
+    kError = 15,
+};
+
+constexpr auto kHeartbeatEvery = std::chrono::milliseconds(100);
+// A follower that hears nothing for this long reconnects
+constexpr auto kLeaderSilence = std::chrono::seconds(3);
+constexpr size_t kMaxFrame = size_t(1) << 30;
+constexpr size_t kSnapshotChunkBytes = 256 * 1024;
+constexpr size_t kMaxCommitsPerSend = 1024;
+
+void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+void putU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+struct Reader {
+    const char* pos;
+    const char* end;
+
+    explicit Reader(const std::string& data) : pos(data.data()), end(data.data() + data.size()) {}
+
+    bool u8(uint8_t& value) {
+        if (end - pos < 1) return false;
+        value = static_cast<uint8_t>(*pos++);
+        return true;
+    }
+    bool u32(uint32_t& value) {
+        if (end - pos < 4) return false;
+        value = 0;
+        for (int i = 3; i >= 0; i--) value = (value << 8) | static_cast<uint8_t>(pos[i]);
+        pos += 4;
+        return true;
+    }
+    bool u64(uint64_t& value) {
+        if (end - pos < 8) return false;
+        value = 0;
+        for (int i = 7; i >= 0; i--) value = (value << 8) | static_cast<uint8_t>(pos[i]);
+        pos += 8;
+        return true;
+    }
+    bool bytes(size_t count, std::string& out) {
+        if (static_cast<size_t>(end - pos) < count) return false;
+        out.assign(pos, count);
+        pos += count;
+        return true;
+    }
+};
+
+// Key encoding on the wire; Hello carries kType so a follower with the
+// other key type is refused instead of misreading the stream
+template<typename Key>
+struct WireKey;
+
+template<>
+struct WireKey<int64_t> {
+    static constexpr uint8_t kType = 0;
+    static constexpr const char* kName = "int64";
+    static void put(std::string& out, int64_t key) { putU64(out, static_cast<uint64_t>(key)); }
+    static bool get(Reader& in, int64_t& key) {
+        uint64_t value;
+        if (!in.u64(value)) return false;
+        key = static_cast<int64_t>(value);
+        return true;
+    }
+};
+
+template<>
+struct WireKey<rbtree::StringKey> {
+    static constexpr uint8_t kType = 1;
+    static constexpr const char* kName = "string";
+    static void put(std::string& out, const rbtree::StringKey& key) {
+        putU32(out, static_cast<uint32_t>(key.str().size()));
+        out += key.str();
+    }
+    static bool get(Reader& in, rbtree::StringKey& key) {
+        uint32_t size;
+        std::string text;
+        if (!in.u32(size) || !in.bytes(size, text)) return false;
+        key = rbtree::StringKey(std::move(text));
+        return true;
+    }
+};
+
+std::string frame(FrameType type, const std::string& payload) {
+    std::string out;
+    out.reserve(5 + payload.size());
+    putU32(out, static_cast<uint32_t>(payload.size() + 1));
+    out.push_back(static_cast<char>(type));
+    out += payload;
+    return out;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Splits the byte stream back into frames
+class FrameReader {
+public:
+    enum Result { Frame, Timeout, Closed, Invalid };
+
+    // wait = false never blocks; otherwise blocks up to the socket's
+    // SO_RCVTIMEO
+    Result next(int fd, bool wait, uint8_t& type, std::string& payload) {
+        char chunk[65536];
+        for (;;) {
+            Result taken = take(type, payload);
+            if (taken != Timeout) return taken;
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), wait ? 0 : MSG_DONTWAIT);
+            if (n > 0) {
+                buffer_.append(chunk, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return Timeout;
+            return Closed;
+        }
+    }
+
+    bool buffered() const { return !buffer_.empty(); }
+
+private:
+    // Timeout here means "need more bytes"
+    Result take(uint8_t& type, std::string& payload) {
+        if (buffer_.size() < 5) return Timeout;
+        Reader header(buffer_);
+        uint32_t length = 0;
+        header.u32(length);
+        if (length == 0 || length > kMaxFrame) return Invalid;
+        if (buffer_.size() < 4 + size_t(length)) return Timeout;
+        type = static_cast<uint8_t>(buffer_[4]);
+        payload.assign(buffer_, 5, length - 1);
+        buffer_.erase(0, 4 + size_t(length));
+        return Frame;
+    }
+
+    std::string buffer_;
+};
+
+void setTimeout(int fd, int option, std::chrono::milliseconds timeout) {
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    ::setsockopt(fd, SOL_SOCKET, option, &tv, sizeof(tv));
+}
+
+void setNoDelay(int fd) {
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int connectTo(const std::string& host, int port, std::string& error) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        error = "cannot resolve " + host;
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* addr = result; addr; addr = addr->ai_next) {
+        fd = ::socket(addr->ai_family, addr->ai_socktype | SOCK_CLOEXEC, addr->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) break;
+        error = std::strerror(errno);
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(result);
+    return fd;
+}
+
+std::string peerName(const sockaddr_in& addr) {
+    char text[INET_ADDRSTRLEN] = "?";
+    ::inet_ntop(AF_INET, &addr.sin_addr, text, sizeof(text));
+    return std::string(text) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+int64_t unixNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t randomEpoch() {
+    std::random_device rd;
+    const uint64_t epoch = (uint64_t(rd()) << 32) ^ rd() ^ static_cast<uint64_t>(unixNowNs());
+    return epoch ? epoch : 1;  // 0 means "never followed anyone"
+}
+
+} // namespace
+
+template<typename Key>
+ReplicationLeader<Key>::ReplicationLeader(size_t logCommits)
+    : logCommits_(std::max<size_t>(logCommits, 1)), epoch_(randomEpoch()) {}
+
+template<typename Key>
+ReplicationLeader<Key>::~ReplicationLeader() {
+    stop();
+}
+
+template<typename Key>
+bool ReplicationLeader<Key>::start(int port, uint64_t version, Snapshot snapshot) {
+    snapshot_ = std::move(snapshot);
+    version_ = version;
+
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    int one = 1;
+    socklen_t length = sizeof(addr);
+    const bool ok = listenFd_ >= 0 &&
+                    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+                    ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+                    ::listen(listenFd_, 16) == 0 &&
+                    ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length) == 0;
+    if (!ok) {
+        std::cerr << "Cannot listen for followers on port " << port << ": " << std::strerror(errno) << std::endl;
+        if (listenFd_ >= 0) ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+    running_ = true;
+    acceptor_ = std::thread(&ReplicationLeader::acceptLoop, this);
+    return true;
+}
+
+template<typename Key>
+void ReplicationLeader<Key>::stop() {
+    if (!running_.exchange(false)) return;
+    ::shutdown(listenFd_, SHUT_RDWR);
+    acceptor_.join();
+    ::close(listenFd_);
+    listenFd_ = -1;
+    {
+        std::lock_guard<std::mutex> lock(logMutex_);
+    }
+    appended_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        for (auto& session : sessions_) ::shutdown(session.fd, SHUT_RDWR);
+    }
+    reap(true);
+}
+
+template<typename Key>
+void ReplicationLeader<Key>::acceptLoop() {
+    while (running_) {
+        sockaddr_in addr{};
+        socklen_t length = sizeof(addr);
+        int fd = ::accept4(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // shut down by stop()
+        }
+        setNoDelay(fd);
+        // A follower that stops reading is dropped rather than stalling
+        // nothing but its own session
+        setTimeout(fd, SO_SNDTIMEO, std::chrono::seconds(10));
+        setTimeout(fd, SO_RCVTIMEO, std::chrono::seconds(5));
+
+        reap(false);
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        Session& session = sessions_.emplace_back();
+        session.fd = fd;
+        session.peer = peerName(addr);
+        session.thread = std::thread(&ReplicationLeader::serve, this, std::ref(session));
+    }
+}
+
+template<typename Key>
+void ReplicationLeader<Key>::reap(bool all) {
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        if (all || it->done) {
+            it->thread.join();
+            ::close(it->fd);
+            it = sessions_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+template<typename Key>
+void ReplicationLeader<Key>::append(const ReplicaCommit<Key>& commit) {
+    std::string payload;
+    putU64(payload, commit.version);
+    putU64(payload, static_cast<uint64_t>(commit.commitUnixNs));
+    putU32(payload, static_cast<uint32_t>(commit.ops.size()));
+    for (const auto& op : commit.ops) {
+        payload.push_back(static_cast<char>(op.first));
+        if (op.first != ReplicaOp::Clear) WireKey<Key>::put(payload, op.second);
+    }
+    auto encoded = std::make_shared<const std::string>(frame(kCommit, payload));
+    {
+        std::lock_guard<std::mutex> lock(logMutex_);
+        log_.push_back({commit.version, std::move(encoded)});
+        if (log_.size() > logCommits_) log_.pop_front();
+        version_ = commit.version;
+    }
+    appended_.notify_all();
+}
+
+template<typename Key>
+bool ReplicationLeader<Key>::sendSnapshot(Session& session, uint64_t& cursor) {
+    ReplicaSnapshot<Key> snapshot = snapshot_();
+    std::string payload;
+    putU64(payload, epoch_);
+    putU64(payload, snapshot.version);
+    putU64(payload, snapshot.keys.size());
+    if (!sendAll(session.fd, frame(kSnapshotBegin, payload))) return false;
+
+    for (size_t i = 0; i < snapshot.keys.size();) {
+        std::string keys;
+        uint32_t count = 0;
+        for (; i < snapshot.keys.size() && keys.size() < kSnapshotChunkBytes; i++, count++) {
+            WireKey<Key>::put(keys, snapshot.keys[i]);
+        }
+        payload.clear();
+        putU32(payload, count);
+        payload += keys;
+        if (!sendAll(session.fd, frame(kSnapshotKeys, payload))) return false;
+    }
+    if (!sendAll(session.fd, frame(kSnapshotEnd, std::string()))) return false;
+    cursor = snapshot.version;
+    session.snapshots++;
+    return true;
+}
+
+template<typename Key>
+void ReplicationLeader<Key>::serve(Session& session) {
+    FrameReader reader;
+    uint8_t type = 0;
+    std::string payload;
+
+    // Hello: magic, key type, epoch last followed, applied version
+    uint8_t keyType = 0;
+    uint64_t epoch = 0, cursor = 0;
+    bool ok = reader.next(session.fd, true, type, payload) == FrameReader::Frame && type == kHello;
+    if (ok) {
+        Reader hello(payload);
+        std::string magic;
+        ok = hello.bytes(sizeof(kMagic), magic) && magic == std::string(kMagic, sizeof(kMagic)) &&
+             hello.u8(keyType) && hello.u64(epoch) && hello.u64(cursor);
+    }
+    if (ok && keyType != WireKey<Key>::kType) {
+        sendAll(session.fd, frame(kError, std::string("the leader serves ") + WireKey<Key>::kName + " keys"));
+        ok = false;
+    }
+    if (!ok) {
+        ::shutdown(session.fd, SHUT_RDWR);
+        session.done = true;
+        return;
+    }
+    std::cout << "Follower " << session.peer << " connected at version " << cursor << std::endl;
+
+    bool resync = epoch != epoch_;
+    if (!resync) session.acked = cursor;
+    auto lastHeartbeat = std::chrono::steady_clock::now();
+    while (running_) {
+        if (resync) {
+            if (!sendSnapshot(session, cursor)) break;
+            resync = false;
+        }
+
+        std::vector<std::shared_ptr<const std::string>> frames;
+        uint64_t leaderVersion;
+        {
+            std::unique_lock<std::mutex> lock(logMutex_);
+            appended_.wait_for(lock, kHeartbeatEvery, [&] { return !running_ || version_ > cursor; });
+            if (!running_) break;
+            leaderVersion = version_;
+            const uint64_t oldest = log_.empty() ? version_ + 1 : log_.front().version;
+            if (cursor > version_ || (version_ > cursor && cursor + 1 < oldest)) {
+                // Too far behind for the log (or ahead of it): start over
+                resync = true;
+                continue;
+            }
+            for (size_t i = static_cast<size_t>(cursor + 1 - oldest);
+                 i < log_.size() && frames.size() < kMaxCommitsPerSend; i++) {
+                frames.push_back(log_[i].frame);
+            }
+        }
+
+        std::string out;
+        for (const auto& f : frames) out += *f;
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastHeartbeat >= kHeartbeatEvery) {
+            std::string beat;
+            putU64(beat, leaderVersion);
+            out += frame(kHeartbeat, beat);
+            lastHeartbeat = now;
+        }
+        if (!out.empty() && !sendAll(session.fd, out)) break;
+        cursor += frames.size();
+
+        FrameReader::Result result;
+        while ((result = reader.next(session.fd, false, type, payload)) == FrameReader::Frame) {
+            Reader ack(payload);
+            uint64_t acked;
+            if (type == kAck && ack.u64(acked)) session.acked = acked;
+        }
+        if (result != FrameReader::Timeout) break;
+    }
+    std::cout << "Follower " << session.peer << " disconnected" << std::endl;
+    ::shutdown(session.fd, SHUT_RDWR);
+    session.done = true;
+}
+
+template<typename Key>
+typename ReplicationLeader<Key>::Status ReplicationLeader<Key>::status() const {
+    Status status;
+    status.epoch = epoch_;
+    {
+        std::lock_guard<std::mutex> lock(logMutex_);
+        status.version = version_;
+        status.oldestLogged = log_.empty() ? version_ : log_.front().version - 1;
+    }
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    for (const auto& session : sessions_) {
+        if (session.done) continue;
+        status.followers.push_back({session.peer, session.acked.load(), session.snapshots.load()});
+    }
+    return status;
+}
+
+template<typename Key>
+ReplicationFollower<Key>::ReplicationFollower(std::string host, int port, Sink sink)
+    : host_(std::move(host)), port_(port), sink_(std::move(sink)) {}
+
+template<typename Key>
+ReplicationFollower<Key>::~ReplicationFollower() {
+    stop();
+}
+
+template<typename Key>
+void ReplicationFollower<Key>::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread(&ReplicationFollower::run, this);
+}
+
+template<typename Key>
+void ReplicationFollower<Key>::stop() {
+    if (!running_.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        if (fd_ >= 0) ::shutdown(fd_, SHUT_RDWR);
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+template<typename Key>
+void ReplicationFollower<Key>::failed(const std::string& error) {
+    std::lock_guard<std::mutex> lock(statusMutex_);
+    status_.connected = false;
+    status_.lastError = error;
+}
+
+template<typename Key>
+void ReplicationFollower<Key>::run() {
+    constexpr auto kMaxBackoff = std::chrono::milliseconds(2000);
+    auto backoff = std::chrono::milliseconds(100);
+    uint64_t connections = 0;
+    while (running_) {
+        std::string error;
+        int fd = connectTo(host_, port_, error);
+        if (fd < 0) {
+            failed("cannot connect to " + leader() + ": " + error);
+        } else {
+            setNoDelay(fd);
+            setTimeout(fd, SO_RCVTIMEO, std::chrono::milliseconds(500));
+            setTimeout(fd, SO_SNDTIMEO, std::chrono::seconds(10));
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex_);
+                fd_ = fd;
+            }
+            {
+                std::lock_guard<std::mutex> lock(statusMutex_);
+                status_.connected = true;
+                status_.reconnects = connections++;
+            }
+            if (follow(fd)) backoff = std::chrono::milliseconds(100);
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex_);
+                fd_ = -1;
+            }
+            ::close(fd);
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait_for(lock, backoff, [this] { return !running_; });
+        backoff = std::min(backoff * 2, kMaxBackoff);
+    }
+}
+
+template<typename Key>
+void ReplicationFollower<Key>::noteLeaderVersion(uint64_t version) {
+    std::lock_guard<std::mutex> lock(statusMutex_);
+    status_.leaderVersion = version;
+    if (status_.appliedVersion >= version) caughtUpAt_ = Clock::now();
+}
+
+template<typename Key>
+bool ReplicationFollower<Key>::follow(int fd) {
+    std::string hello(kMagic, sizeof(kMagic));
+    hello.push_back(static_cast<char>(WireKey<Key>::kType));
+    putU64(hello, epoch_);
+    putU64(hello, sink_.version());
+    if (!sendAll(fd, frame(kHello, hello))) {
+        failed("cannot greet " + leader());
+        return true;
+    }
+
+    FrameReader reader;
+    uint8_t type = 0;
+    std::string payload;
+    ReplicaSnapshot<Key> incoming;
+    bool inSnapshot = false;
+    uint64_t incomingEpoch = 0, acked = 0;
+    auto lastHeard = Clock::now();
+    auto malformed = [this] {
+        failed("malformed frame from " + leader());
+        epoch_ = 0;  // resync from a snapshot next time
+        return false;
+    };
+
+    while (running_) {
+        const auto result = reader.next(fd, true, type, payload);
+        if (result == FrameReader::Timeout) {
+            if (Clock::now() - lastHeard < kLeaderSilence) continue;
+            failed("no word from " + leader() + " in 3s");
+            return true;
+        }
+        if (result == FrameReader::Closed) {
+            failed("connection to " + leader() + " closed");
+            return true;
+        }
+        if (result == FrameReader::Invalid) return malformed();
+        lastHeard = Clock::now();
+
+        Reader in(payload);
+        switch (type) {
+        case kSnapshotBegin: {
+            uint64_t count;
+            if (!in.u64(incomingEpoch) || !in.u64(incoming.version) || !in.u64(count)) return malformed();
+            incoming.keys.clear();
+            incoming.keys.reserve(static_cast<size_t>(std::min<uint64_t>(count, 1 << 24)));
+            inSnapshot = true;
+            break;
+        }
+        case kSnapshotKeys: {
+            uint32_t count;
+            if (!inSnapshot || !in.u32(count)) return malformed();
+            for (uint32_t i = 0; i < count; i++) {
+                Key key{};
+                if (!WireKey<Key>::get(in, key)) return malformed();
+                incoming.keys.push_back(std::move(key));
+            }
+            break;
+        }
+        case kSnapshotEnd: {
+            if (!inSnapshot) return malformed();
+            const uint64_t version = incoming.version;
+            sink_.applySnapshot(std::move(incoming));
+            incoming = ReplicaSnapshot<Key>();
+            inSnapshot = false;
+            epoch_ = incomingEpoch;
+            std::lock_guard<std::mutex> lock(statusMutex_);
+            status_.appliedVersion = version;
+            status_.leaderVersion = version;
+            status_.snapshots++;
+            caughtUpAt_ = Clock::now();
+            break;
+        }
+        case kCommit: {
+            ReplicaCommit<Key> commit;
+            uint64_t unixNs;
+            uint32_t count;
+            if (inSnapshot || !in.u64(commit.version) || !in.u64(unixNs) || !in.u32(count)) return malformed();
+            commit.commitUnixNs = static_cast<int64_t>(unixNs);
+            commit.ops.reserve(count);
+            for (uint32_t i = 0; i < count; i++) {
+                uint8_t op;
+                Key key{};
+                if (!in.u8(op) || op < 1 || op > 3) return malformed();
+                if (static_cast<ReplicaOp>(op) != ReplicaOp::Clear && !WireKey<Key>::get(in, key)) return malformed();
+                commit.ops.emplace_back(static_cast<ReplicaOp>(op), std::move(key));
+            }
+            if (commit.version != sink_.version() + 1) {
+                failed("gap in the stream from " + leader());
+                epoch_ = 0;
+                return true;
+            }
+            sink_.applyCommit(commit);
+            std::lock_guard<std::mutex> lock(statusMutex_);
+            status_.appliedVersion = commit.version;
+            status_.leaderVersion = std::max(status_.leaderVersion, commit.version);
+            status_.lastApplyDelayMs = (unixNowNs() - commit.commitUnixNs) / 1e6;
+            if (status_.appliedVersion >= status_.leaderVersion) caughtUpAt_ = Clock::now();
+            break;
+        }
+        case kHeartbeat: {
+            uint64_t version;
+            if (!in.u64(version)) return malformed();
+            noteLeaderVersion(version);
+            break;
+        }
+        case kError:
+            failed(leader() + " refused: " + payload);
+            return false;
+        default:
+            return malformed();
+        }
+
+        // Ack once the burst that arrived together has been applied
+        if (!reader.buffered() && !inSnapshot) {
+            const uint64_t applied = sink_.version();
+            if (applied != acked) {
+                std::string ack;
+                putU64(ack, applied);
+                if (!sendAll(fd, frame(kAck, ack))) {
+                    failed("connection to " + leader() + " closed");
+                    return true;
+                }
+                acked = applied;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Key>
+typename ReplicationFollower<Key>::Status ReplicationFollower<Key>::status() const {
+    std::lock_guard<std::mutex> lock(statusMutex_);
+    Status status = status_;
+    if (status.appliedVersion < status.leaderVersion) {
+        status.lagMs = std::chrono::duration<double, std::milli>(Clock::now() - caughtUpAt_).count();
+    }
+    return status;
+}
+
+template class ReplicationLeader<int64_t>;
+template class ReplicationLeader<rbtree::StringKey>;
+template class ReplicationFollower<int64_t>;
+template class ReplicationFollower<rbtree::StringKey>;
@@ -0,0 +1,178 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Leader/follower replication of TreeAPI's index over TCP.
+//
+// Every mutation on the leader becomes a commit: the ops it applied and the
+// tree version it produced. Versions are consecutive, so a follower that
+// has applied version v needs exactly the commits after v. The leader keeps
+// the last logCommits commits, encoded once and shared by every follower
+// connection; a follower further behind than that (or new, or one whose
+// leader restarted) first receives a snapshot of every key at some version
+// and continues from there.
+//
+// Frames in both directions are a u32 length, a u8 type and the payload,
+// integers little-endian. The follower opens with Hello (key type, the
+// leader epoch it last followed, its version) and acks what it has
+// applied; the leader sends SnapshotBegin/Keys/End, Commit and, when idle,
+// Heartbeat with its current version so followers can report their lag.
+// Linux sockets, like EventLoopServer.
+enum class ReplicaOp : uint8_t { Insert = 1, Remove = 2, Clear = 3 };
+
+template<typename Key>
+struct ReplicaCommit {
+    uint64_t version = 0;      // the leader's tree version after the commit
+    int64_t commitUnixNs = 0;  // leader wall clock, for the follower's delay
+    std::vector<std::pair<ReplicaOp, Key>> ops;  // Clear carries a default key
+};
+
+template<typename Key>
+struct ReplicaSnapshot {
+    uint64_t version = 0;
+    std::vector<Key> keys;  // in order
+};
+
+template<typename Key>
+class ReplicationLeader {
+public:
+    // Copies every key and the version they were read at, under the tree's
+    // shared lock
+    using Snapshot = std::function<ReplicaSnapshot<Key>()>;
+
+    struct FollowerStatus {
+        std::string peer;
+        uint64_t ackedVersion = 0;
+        uint64_t snapshots = 0;  // full resyncs sent
+    };
+    struct Status {
+        uint64_t epoch = 0;
+        uint64_t version = 0;
+        uint64_t oldestLogged = 0;  // first version a follower can resume after, minus one
+        std::vector<FollowerStatus> followers;
+    };
+
+    explicit ReplicationLeader(size_t logCommits);
+    ~ReplicationLeader();
+
+    ReplicationLeader(const ReplicationLeader&) = delete;
+    ReplicationLeader& operator=(const ReplicationLeader&) = delete;
+
+    // Listens on port (all interfaces) from a tree at `version`; false if
+    // the port cannot be bound
+    bool start(int port, uint64_t version, Snapshot snapshot);
+    void stop();
+
+    // Called under the tree's exclusive lock, so commits arrive in order
+    void append(const ReplicaCommit<Key>& commit);
+
+    Status status() const;
+    int port() const { return port_; }
+
+private:
+    struct Logged {
+        uint64_t version;
+        std::shared_ptr<const std::string> frame;
+    };
+    struct Session {
+        int fd = -1;
+        std::string peer;
+        std::atomic<uint64_t> acked{0};
+        std::atomic<uint64_t> snapshots{0};
+        std::atomic<bool> done{false};
+        std::thread thread;
+    };
+
+    void acceptLoop();
+    void serve(Session& session);
+    bool sendSnapshot(Session& session, uint64_t& cursor);
+    void reap(bool all);
+
+    const size_t logCommits_;
+    const uint64_t epoch_;
+    Snapshot snapshot_;
+    int listenFd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread acceptor_;
+
+    mutable std::mutex logMutex_;
+    std::condition_variable appended_;
+    std::deque<Logged> log_;
+    uint64_t version_ = 0;
+
+    mutable std::mutex sessionsMutex_;
+    std::list<Session> sessions_;
+};
+
+template<typename Key>
+class ReplicationFollower {
+public:
+    // How the stream reaches the follower's tree; each call takes the
+    // tree's exclusive lock itself
+    struct Sink {
+        std::function<uint64_t()> version;
+        std::function<void(ReplicaSnapshot<Key>&&)> applySnapshot;
+        std::function<void(const ReplicaCommit<Key>&)> applyCommit;
+    };
+
+    struct Status {
+        bool connected = false;
+        uint64_t appliedVersion = 0;
+        uint64_t leaderVersion = 0;   // newest the leader has reported
+        double lagMs = 0;             // how long since the follower was last caught up
+        double lastApplyDelayMs = 0;  // leader commit to follower apply, latest commit
+        uint64_t snapshots = 0;
+        uint64_t reconnects = 0;
+        std::string lastError;
+    };
+
+    ReplicationFollower(std::string host, int port, Sink sink);
+    ~ReplicationFollower();
+
+    ReplicationFollower(const ReplicationFollower&) = delete;
+    ReplicationFollower& operator=(const ReplicationFollower&) = delete;
+
+    // Connects in the background and reconnects with backoff until stop()
+    void start();
+    void stop();
+
+    Status status() const;
+    std::string leader() const { return host_ + ":" + std::to_string(port_); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    // Reads frames until the connection drops or stop(); false on a protocol
+    // error that warrants waiting before the next attempt
+    bool follow(int fd);
+    void failed(const std::string& error);
+    void noteLeaderVersion(uint64_t version);
+
+    const std::string host_;
+    const int port_;
+    Sink sink_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::mutex wakeMutex_;  // also guards fd_, so stop() can shut it down
+    int fd_ = -1;
+    std::condition_variable wake_;
+
+    uint64_t epoch_ = 0;  // only touched by the follower thread
+
+    mutable std::mutex statusMutex_;
+    Status status_;
+    Clock::time_point caughtUpAt_ = Clock::now();
+};
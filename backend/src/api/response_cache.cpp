@@ -0,0 +1,108 @@
+#include "response_cache.h"
+
+#ifdef RBT_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+ResponseCache::Bytes ResponseCache::get(const std::string& key, uint64_t version, uint64_t generation,
+                                        const Builder& build) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (generation != generation_.load()) {
+        // The caller's version may belong to the previous generation
+        counters.misses++;
+        lock.unlock();
+        return std::make_shared<const std::string>(build());
+    }
+    // Slots are never erased, so this reference survives rehashing, clear()
+    // and every wait below
+    Entry& entry = entries[key];
+
+    bool waited = false;
+    while (true) {
+        if (entry.bytes && entry.version >= version && generation == generation_.load()) {
+            if (waited) {
+                counters.coalesced++;
+            } else {
+                counters.hits++;
+            }
+            return entry.bytes;
+        }
+        if (!entry.building) break;
+        // Someone is already building this key; their result is either new
+        // enough for us, or we rebuild after them, never alongside them
+        waited = true;
+        built.wait(lock);
+    }
+
+    entry.building = true;
+    counters.misses++;
+    lock.unlock();
+
+    Bytes bytes;
+    try {
+        bytes = std::make_shared<const std::string>(build());
+    } catch (...) {
+        lock.lock();
+        entry.building = false;
+        built.notify_all();
+        throw;
+    }
+
+    lock.lock();
+    // A clear() during the build reset this slot; the bytes may be from
+    // either side of it, so they go to this caller only
+    if (generation == generation_.load() && (!entry.bytes || version >= entry.version)) {
+        entry.bytes = bytes;
+        entry.version = version;
+    }
+    entry.building = false;
+    built.notify_all();
+    return bytes;
+}
+
+void ResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    generation_++;
+    // Emptied rather than erased: waiters hold references to their slot.
+    // Keys are endpoint names, so the slots never add up to much.
+    for (auto& slot : entries) {
+        slot.second.bytes.reset();
+        slot.second.version = 0;
+    }
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+bool ResponseCache::gzipAvailable() {
+#ifdef RBT_WITH_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ResponseCache::gzip(const std::string& data, std::string& out) {
+#ifdef RBT_WITH_ZLIB
+    z_stream stream{};
+    // 15 + 16: zlib window with a gzip header
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&stream, data.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+#else
+    (void)data;
+    (void)out;
+    return false;
+#endif
+}
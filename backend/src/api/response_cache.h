@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Cache of fully serialized response bodies for the read endpoints.
+//
+// Entries are keyed by name (endpoint + encoding) and tagged with the tree
+// version they were built from; a mutation bumps the version, which makes
+// every older entry a miss without touching the cache. Misses are
+// single-flighted per key: one caller runs the builder while the others
+// wait and share its bytes. A hit is a map lookup and a shared_ptr copy,
+// so serving it costs one memcpy into the response.
+//
+// clear() starts a new generation, for when versions stop being monotonic
+// (a follower adopting a new leader's snapshot). A caller reads generation()
+// before the version; bytes are only served and stored within the
+// generation the caller saw, so a build that straddles a clear() can never
+// be cached under a version from before it.
+class ResponseCache {
+public:
+    using Bytes = std::shared_ptr<const std::string>;
+    using Builder = std::function<std::string()>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;     // builds
+        uint64_t coalesced = 0;  // waited for another caller's build
+    };
+
+    // Returns bytes for `key` built at `version` or later. `build` must
+    // produce a snapshot no older than `version`. A `generation` older than
+    // the current one always builds and caches nothing.
+    Bytes get(const std::string& key, uint64_t version, uint64_t generation, const Builder& build);
+
+    uint64_t generation() const { return generation_.load(); }
+    void clear();
+    Stats stats() const;
+
+    // gzip-compresses `data`; returns false when built without zlib
+    static bool gzip(const std::string& data, std::string& out);
+    static bool gzipAvailable();
+
+private:
+    struct Entry {
+        uint64_t version = 0;
+        Bytes bytes;
+        bool building = false;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable built;
+    std::unordered_map<std::string, Entry> entries;
+    Stats counters;
+    // Written under mutex, read without it by callers tagging a request
+    std::atomic<uint64_t> generation_{0};
+};
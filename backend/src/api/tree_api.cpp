@@ -1,24 +1,450 @@
 #include "tree_api.h"
+#include "../server/event_loop_server.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <random>
+#include <stdexcept>
 #include <chrono>
+#include <climits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
 
-TreeAPI::TreeAPI() {
+namespace {
+
+// How each key type travels through the API: JSON bodies, the search path
+// and response payloads
+template<typename Key>
+struct ApiKey;
+
+template<>
+struct ApiKey<int64_t> {
+    static constexpr const char* kPathPattern = "(-?\\d+)";
+    static int64_t fromJson(const json& value) { return value.get<int64_t>(); }
+    // Also parses query parameters, so trailing junk is an error
+    static int64_t fromPath(const std::string& text) {
+        size_t used = 0;
+        const int64_t key = std::stoll(text, &used);
+        if (used != text.size()) throw std::invalid_argument("'" + text + "' is not an integer key");
+        return key;
+    }
+    static int64_t fromNumber(int number) { return number; }
+    static json toJson(int64_t key) { return key; }
+    static void toTrace(int64_t key, int64_t& intKey, std::string&) { intKey = key; }
+    static size_t heapBytes(int64_t) { return 0; }
+
+    static constexpr bool kHasSum = true;
+    // Sums past int64 go out as exact decimal strings rather than doubles
+    static json sumToJson(__int128 sum) {
+        if (sum >= INT64_MIN && sum <= INT64_MAX) return static_cast<int64_t>(sum);
+        const bool negative = sum < 0;
+        unsigned __int128 magnitude = negative ? -static_cast<unsigned __int128>(sum) : sum;
+        std::string digits;
+        do {
+            digits.insert(digits.begin(), static_cast<char>('0' + magnitude % 10));
+            magnitude /= 10;
+        } while (magnitude != 0);
+        return (negative ? "-" : "") + digits;
+    }
+};
+
+template<>
+struct ApiKey<rbtree::StringKey> {
+    static constexpr const char* kPathPattern = "(.+)";
+    // Numbers are accepted too, so the frontend's numeric inserts still work
+    static rbtree::StringKey fromJson(const json& value) {
+        return value.is_string() ? value.get<std::string>() : value.dump();
+    }
+    static rbtree::StringKey fromPath(const std::string& text) { return text; }
+    static rbtree::StringKey fromNumber(int number) { return std::to_string(number); }
+    static json toJson(const rbtree::StringKey& key) { return key.str(); }
+    static void toTrace(const rbtree::StringKey& key, int64_t&, std::string& stringKey) { stringKey = key.str(); }
+    // Characters past the small-string buffer live in their own allocation
+    static size_t heapBytes(const rbtree::StringKey& key) {
+        const std::string& text = key.str();
+        return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+    }
+
+    static constexpr bool kHasSum = false;
+    static json sumToJson(const rbtree::KeySum<rbtree::StringKey>::type&) { return nullptr; }
+};
+
+// Insert bodies give "ttl" in seconds; fractions are fine, anything that
+// rounds to nothing becomes a millisecond rather than no TTL at all
+std::chrono::milliseconds ttlFromJson(const json& value) {
+    constexpr double kMaxSeconds = 1e9;
+    if (!value.is_number()) throw std::invalid_argument("ttl must be a number of seconds");
+    const double seconds = value.get<double>();
+    if (!(seconds >= 0 && seconds <= kMaxSeconds)) {
+        throw std::invalid_argument("ttl must be between 0 and 1e9 seconds");
+    }
+    const auto ms = static_cast<int64_t>(seconds * 1000 + 0.5);
+    return std::chrono::milliseconds(seconds > 0 ? std::max<int64_t>(ms, 1) : 0);
+}
+
+// "" (no suffix) is every aggregate at once
+TraceAggregate aggregateKind(const std::string& name) {
+    for (size_t i = 1; i < kTraceAggregateCount; i++) {
+        if (name == traceAggregateName(static_cast<TraceAggregate>(i))) return static_cast<TraceAggregate>(i);
+    }
+    return TraceAggregate::All;
+}
+
+// Times one route call and appends it to the capture trace on the way out.
+// Costs a null check when capture is off.
+template<typename Key>
+class CapturedCall {
+public:
+    CapturedCall(WorkloadTraceWriter* trace, TraceOp op, const httplib::Response& res)
+        : trace(trace), res(res) {
+        if (trace) {
+            record.op = op;
+            start = WorkloadTraceWriter::Clock::now();
+        }
+    }
+
+    // A deferred call is recorded by the run that answers it
+    ~CapturedCall() {
+        if (!trace || EventLoopServer::deferred()) return;
+        record.startNs = trace->sinceStart(start);
+        record.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            WorkloadTraceWriter::Clock::now() - start).count();
+        record.status = static_cast<uint16_t>(res.status > 0 ? res.status : 200);
+        trace->append(record);
+    }
+
+    CapturedCall(const CapturedCall&) = delete;
+    CapturedCall& operator=(const CapturedCall&) = delete;
+
+    void setKey(const Key& key) {
+        if (!trace) return;
+        record.hasKey = true;
+        ApiKey<Key>::toTrace(key, record.intKey, record.stringKey);
+    }
+
+    void setTtl(std::chrono::milliseconds ttl) {
+        if (trace) record.ttlMs = ttl.count();
+    }
+
+    void setRange(TraceAggregate kind, const Key* from, const Key* to) {
+        if (!trace) return;
+        record.aggregate = kind;
+        if (from) setKey(*from);
+        if (to) {
+            record.hasUpperKey = true;
+            ApiKey<Key>::toTrace(*to, record.upperIntKey, record.upperStringKey);
+        }
+    }
+
+private:
+    WorkloadTraceWriter* trace;
+    const httplib::Response& res;
+    WorkloadTraceWriter::Clock::time_point start;
+    TraceRecord record;
+};
+
+} // namespace
+
+template<typename Key>
+TreeAPI<Key>::TreeAPI(const std::string& engine, const RetentionConfig& retentionConfig) {
     std::cout << "=== TreeAPI Constructor ===" << std::endl;
-    tree = std::make_unique<rbtree::RedBlackTree<int>>();
+    tree = rbtree::makeOrderedIndex<Key>(engine);
+    if (!tree) {
+        throw std::invalid_argument("Unknown index engine '" + engine + "'");
+    }
+    setParallelism(0);
+    retention = std::make_unique<KeyRetention<Key>>(retentionConfig);
+    expirer = std::thread(&TreeAPI::runExpirer, this);
+    std::cout << "Index engine: " << tree->engine() << std::endl;
     std::cout << "Initial tree size: " << tree->size() << std::endl;
     
     // If tree already has nodes, something is wrong
     if (!tree->empty()) {
         std::cout << "ERROR: Tree not empty after construction!" << std::endl;
-        auto nodes = tree->getAllNodes();
-        for (auto node : nodes) {
-            std::cout << "Unexpected node: " << node->data << std::endl;
+        tree->forEach([](const Key& value) {
+            std::cout << "Unexpected node: " << ApiKey<Key>::toJson(value) << std::endl;
+        });
+    }
+}
+
+template<typename Key>
+TreeAPI<Key>::~TreeAPI() {
+    // Both call back into this object
+    if (replicationFollower) replicationFollower->stop();
+    if (replicationLeader) replicationLeader->stop();
+    {
+        std::lock_guard<std::mutex> lock(expirerMutex);
+        expirerStopping = true;
+    }
+    expirerWake.notify_one();
+    expirer.join();
+}
+
+template<typename Key>
+void TreeAPI<Key>::runExpirer() {
+    std::unique_lock<std::mutex> lock(expirerMutex);
+    while (!expirerStopping) {
+        expirerWake.wait_for(lock, retention->config().tick);
+        if (expirerStopping) break;
+        lock.unlock();
+        expireDue();
+        lock.lock();
+    }
+}
+
+template<typename Key>
+size_t TreeAPI<Key>::expireDue() {
+    size_t total = 0;
+    // Skips the lock entirely while no key has a TTL
+    while (retention->pending() > 0) {
+        size_t removed;
+        {
+            std::unique_lock<std::shared_mutex> lock(treeMutex);
+            removed = retention->expire(KeyRetention<Key>::Clock::now(), [this](const Key& key) {
+                tree->remove(key);
+                recordLocked(ReplicaOp::Remove, key);
+                captureRemoval(TraceOp::Expire, key);
+            });
+            if (removed > 0) commitLocked();
+        }
+        total += removed;
+        if (removed < retention->config().expireBatch) break;
+        std::this_thread::yield();
+    }
+    return total;
+}
+
+template<typename Key>
+bool TreeAPI<Key>::startReplicationLeader(int port, size_t logCommits) {
+    auto leader = std::make_unique<ReplicationLeader<Key>>(logCommits);
+    std::unique_lock<std::shared_mutex> lock(treeMutex);
+    if (!leader->start(port, treeVersion.load(), [this] { return snapshot(); })) return false;
+    replicationLeader = std::move(leader);
+    std::cout << "Replication leader listening on port " << replicationLeader->port() << std::endl;
+    return true;
+}
+
+template<typename Key>
+void TreeAPI<Key>::startReplicationFollower(const std::string& host, int port) {
+    typename ReplicationFollower<Key>::Sink sink;
+    sink.version = [this] { return treeVersion.load(); };
+    sink.applySnapshot = [this](ReplicaSnapshot<Key>&& snapshot) { applySnapshot(std::move(snapshot)); };
+    sink.applyCommit = [this](const ReplicaCommit<Key>& commit) { applyCommit(commit); };
+    replicationFollower = std::make_unique<ReplicationFollower<Key>>(host, port, std::move(sink));
+    replicationFollower->start();
+    std::cout << "Following the replication leader at " << replicationFollower->leader() << std::endl;
+}
+
+template<typename Key>
+void TreeAPI<Key>::captureRemoval(TraceOp op, const Key& key) {
+    if (!capture) return;
+    TraceRecord record;
+    record.op = op;
+    record.startNs = capture->sinceStart(WorkloadTraceWriter::Clock::now());
+    record.durationNs = 0;
+    record.hasKey = true;
+    ApiKey<Key>::toTrace(key, record.intKey, record.stringKey);
+    capture->append(record);
+}
+
+template<typename Key>
+void TreeAPI<Key>::recordLocked(ReplicaOp op, const Key& key) {
+    if (replicationLeader) pendingCommit.ops.emplace_back(op, key);
+}
+
+template<typename Key>
+void TreeAPI<Key>::commitLocked() {
+    const uint64_t version = ++treeVersion;
+    if (!replicationLeader) return;
+    pendingCommit.version = version;
+    pendingCommit.commitUnixNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    replicationLeader->append(pendingCommit);
+    pendingCommit.ops.clear();
+}
+
+template<typename Key>
+ReplicaSnapshot<Key> TreeAPI<Key>::snapshot() {
+    std::shared_lock<std::shared_mutex> lock(treeMutex);
+    ReplicaSnapshot<Key> snapshot;
+    snapshot.version = treeVersion.load();
+    snapshot.keys.reserve(tree->size());
+    tree->forEach([&snapshot](const Key& key) { snapshot.keys.push_back(key); });
+    return snapshot;
+}
+
+template<typename Key>
+void TreeAPI<Key>::applySnapshot(ReplicaSnapshot<Key>&& snapshot) {
+    // Built off to the side so reads continue on the old index meanwhile
+    auto fresh = rbtree::makeOrderedIndex<Key>(tree->engine());
+    for (const Key& key : snapshot.keys) fresh->insert(key);
+    {
+        std::unique_lock<std::shared_mutex> lock(treeMutex);
+        tree.swap(fresh);
+        retention->cleared();
+        // A new leader epoch can restart versions below cached ones.
+        // serveCached() reads the generation and version under the shared
+        // lock, so it sees both old or both new.
+        treeVersion = snapshot.version;
+        responseCache.clear();
+    }
+    versionApplied();
+}
+
+template<typename Key>
+void TreeAPI<Key>::applyCommit(const ReplicaCommit<Key>& commit) {
+    {
+        std::unique_lock<std::shared_mutex> lock(treeMutex);
+        for (const auto& op : commit.ops) {
+            switch (op.first) {
+            case ReplicaOp::Insert: tree->insert(op.second); break;
+            case ReplicaOp::Remove: tree->remove(op.second); break;
+            case ReplicaOp::Clear: tree->clear(); break;
+            }
+        }
+        treeVersion = commit.version;
+    }
+    versionApplied();
+}
+
+template<typename Key>
+void TreeAPI<Key>::versionApplied() {
+    { std::lock_guard<std::mutex> lock(versionMutex); }
+    versionAdvanced.notify_all();
+    if (EventLoopServer* loops = readLoops.load()) loops->resume_deferred();
+}
+
+template<typename Key>
+bool TreeAPI<Key>::awaitVersion(const httplib::Request& req, httplib::Response& res) {
+    if (!req.has_param("minVersion")) return true;
+    uint64_t wanted;
+    try {
+        const std::string text = req.get_param_value("minVersion");
+        size_t used = 0;
+        wanted = std::stoull(text, &used);
+        if (used != text.size() || text[0] == '-') throw std::invalid_argument(text);
+    } catch (const std::exception&) {
+        res.status = 400;
+        res.set_content(errorResponse("Invalid request: minVersion must be a tree version").dump(), "application/json");
+        return false;
+    }
+    if (treeVersion.load() >= wanted) return true;
+
+    // Only a follower's version advances without this server's own writes,
+    // and a loop thread must not sleep: it parks the request and runs it
+    // again after each versionApplied() until readWait has passed
+    if (replicationFollower) {
+        if (readLoops.load()) {
+            if (EventLoopServer::defer(readWait)) return false;
+        } else {
+            std::unique_lock<std::mutex> lock(versionMutex);
+            if (versionAdvanced.wait_for(lock, readWait, [&] { return treeVersion.load() >= wanted; })) return true;
+        }
+    }
+    json error = errorResponse("Version " + std::to_string(wanted) +
+                               (replicationFollower ? " has not been replicated here yet" : " has not been committed yet"));
+    error["data"] = {{"version", treeVersion.load()}, {"minVersion", wanted}};
+    res.status = 503;
+    res.set_header("Retry-After", "1");
+    res.set_content(error.dump(), "application/json");
+    return false;
+}
+
+template<typename Key>
+bool TreeAPI<Key>::acceptWrite(httplib::Response& res) {
+    if (!replicationFollower) return true;
+    json error = errorResponse("Read-only follower; send writes to the leader");
+    error["data"] = {{"leader", replicationFollower->leader()}};
+    res.status = 403;
+    res.set_content(error.dump(), "application/json");
+    return false;
+}
+
+template<typename Key>
+json TreeAPI<Key>::replicationStatus() {
+    if (replicationFollower) {
+        const auto status = replicationFollower->status();
+        return successResponse("Replication status", {
+            {"role", "follower"},
+            {"leader", replicationFollower->leader()},
+            {"connected", status.connected},
+            {"version", treeVersion.load()},
+            {"leaderVersion", status.leaderVersion},
+            {"lagVersions", status.leaderVersion > status.appliedVersion ? status.leaderVersion - status.appliedVersion : 0},
+            {"lagMs", status.lagMs},
+            {"lastApplyDelayMs", status.lastApplyDelayMs},
+            {"snapshots", status.snapshots},
+            {"reconnects", status.reconnects},
+            {"lastError", status.lastError}
+        });
+    }
+    if (replicationLeader) {
+        const auto status = replicationLeader->status();
+        json followers = json::array();
+        for (const auto& follower : status.followers) {
+            followers.push_back({
+                {"peer", follower.peer},
+                {"ackedVersion", follower.ackedVersion},
+                {"lagVersions", status.version > follower.ackedVersion ? status.version - follower.ackedVersion : 0},
+                {"snapshots", follower.snapshots}
+            });
         }
+        return successResponse("Replication status", {
+            {"role", "leader"},
+            {"port", replicationLeader->port()},
+            {"version", status.version},
+            {"oldestLogged", status.oldestLogged},
+            {"followers", followers}
+        });
     }
+    return successResponse("Replication status", {
+        {"role", "standalone"},
+        {"version", treeVersion.load()}
+    });
+}
+
+template<typename Key>
+size_t TreeAPI<Key>::entryBytes(const Key& value) const {
+    // The key is held by the index, the retention map and the eviction queue
+    return tree->bytesPerKey() + KeyRetention<Key>::overheadBytes() + 3 * ApiKey<Key>::heapBytes(value);
+}
+
+template<typename Key>
+void TreeAPI<Key>::setParallelism(size_t threads, int cutoffDepth) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (cutoffDepth < 0) {
+        // 2^cutoff subtrees: at least 16 per thread
+        cutoffDepth = 4;
+        while ((size_t(1) << cutoffDepth) < threads * 16) cutoffDepth++;
+    }
+    std::unique_lock<std::shared_mutex> lock(treeMutex);
+    pool = std::make_unique<rbtree::WorkStealingPool>(threads);
+    parallelCutoff = cutoffDepth;
+}
+
+template<typename Key>
+bool TreeAPI<Key>::useParallel() const {
+    return pool->parallelism() > 1 && tree->size() >= kParallelMinNodes;
+}
+
+template<typename Key>
+int TreeAPI<Key>::treeHeight() {
+    return useParallel() ? tree->height(*pool, parallelCutoff) : tree->height();
+}
+
+template<typename Key>
+bool TreeAPI<Key>::treeValid() {
+    return useParallel() ? tree->validate(*pool, parallelCutoff) : tree->validate();
 }
 
-void TreeAPI::setupRoutes(httplib::Server& server) {
+template<typename Key>
+template<typename Server>
+void TreeAPI<Key>::setupRoutes(Server& server) {
+    if constexpr (std::is_same<Server, EventLoopServer>::value) readLoops = &server;
 
 
 
@@ -31,7 +457,10 @@ void TreeAPI::setupRoutes(httplib::Server& server) {
         std::cout << "Method: " << req.method << std::endl;
         std::cout.flush();
         
+        CapturedCall<Key> call(capture.get(), TraceOp::Random, res);
+        if (!acceptWrite(res)) return;
         auto result = insertRandom();
+        if (result["success"]) call.setKey(ApiKey<Key>::fromJson(result["data"]["value"]));
         res.set_content(result.dump(), "application/json");
         
         std::cout << "=== RANDOM API ENDPOINT COMPLETE ===" << std::endl;
@@ -56,7 +485,8 @@ void TreeAPI::setupRoutes(httplib::Server& server) {
     });
     
     // Your existing API routes...
-    server.Get("/api/health", [](const httplib::Request&, httplib::Response& res) {
+    server.Get("/api/health", [this](const httplib::Request&, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Health, res);
         json response = {
             {"status", "healthy"},
             {"timestamp", time(nullptr)}
@@ -65,17 +495,24 @@ void TreeAPI::setupRoutes(httplib::Server& server) {
     });
 
     // Get tree data
-    server.Get("/api/tree", [this](const httplib::Request&, httplib::Response& res) {
-        auto response = getTreeData();
-        res.set_content(response.dump(), "application/json");
+    server.Get("/api/tree", [this](const httplib::Request& req, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Tree, res);
+        if (!awaitVersion(req, res)) return;
+        serveCached("tree", &TreeAPI::getTreeData, req, res);
     });
 
     // Insert node
     server.Post("/api/tree/insert", [this](const httplib::Request& req, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Insert, res);
+        if (!acceptWrite(res)) return;
         try {
             auto body = json::parse(req.body);
-            int value = body["value"];
-            auto response = insertNode(value);
+            Key value = ApiKey<Key>::fromJson(body["value"]);
+            call.setKey(value);
+            auto ttl = KeyRetention<Key>::kDefaultTtl;
+            if (body.contains("ttl")) ttl = ttlFromJson(body["ttl"]);
+            call.setTtl(ttl);
+            auto response = insertNode(value, ttl);
             res.set_content(response.dump(), "application/json");
         } catch (const std::exception& e) {
             auto error = errorResponse("Invalid request: " + std::string(e.what()));
@@ -86,9 +523,12 @@ void TreeAPI::setupRoutes(httplib::Server& server) {
 
     // Delete node
     server.Delete("/api/tree/delete", [this](const httplib::Request& req, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Delete, res);
+        if (!acceptWrite(res)) return;
         try {
             auto body = json::parse(req.body);
-            int value = body["value"];
+            Key value = ApiKey<Key>::fromJson(body["value"]);
+            call.setKey(value);
             auto response = deleteNode(value);
             res.set_content(response.dump(), "application/json");
         } catch (const std::exception& e) {
@@ -99,9 +539,12 @@ void TreeAPI::setupRoutes(httplib::Server& server) {
     });
 
     // Search node
-    server.Get("/api/tree/search/(\\d+)", [this](const httplib::Request& req, httplib::Response& res) {
+    server.Get(std::string("/api/tree/search/") + ApiKey<Key>::kPathPattern, [this](const httplib::Request& req, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Search, res);
         try {
-            int value = std::stoi(req.matches[1]);
+            Key value = ApiKey<Key>::fromPath(req.matches[1]);
+            call.setKey(value);
+            if (!awaitVersion(req, res)) return;
             auto response = searchNode(value);
             res.set_content(response.dump(), "application/json");
         } catch (const std::exception& e) {
@@ -113,50 +556,99 @@ void TreeAPI::setupRoutes(httplib::Server& server) {
 
     // Clear tree
     server.Post("/api/tree/clear", [this](const httplib::Request&, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Clear, res);
+        if (!acceptWrite(res)) return;
         auto response = clearTree();
         res.set_content(response.dump(), "application/json");
     });
 
     // Get statistics
-    server.Get("/api/tree/stats", [this](const httplib::Request&, httplib::Response& res) {
-        auto response = getTreeStats();
-        res.set_content(response.dump(), "application/json");
+    server.Get("/api/tree/stats", [this](const httplib::Request& req, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Stats, res);
+        if (!awaitVersion(req, res)) return;
+        serveCached("stats", &TreeAPI::getTreeStats, req, res);
+    });
+
+    // Retention and write-combining counters; never cached, they move
+    // without a version bump (refreshed TTLs, inserts of existing keys)
+    server.Get("/api/tree/stats/live", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(successResponse("Live statistics retrieved", liveStats()).dump(), "application/json");
     });
 
     // Validate tree
-    server.Get("/api/tree/validate", [this](const httplib::Request&, httplib::Response& res) {
-        auto response = validateTree();
-        res.set_content(response.dump(), "application/json");
+    server.Get("/api/tree/validate", [this](const httplib::Request& req, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Validate, res);
+        if (!awaitVersion(req, res)) return;
+        serveCached("validate", &TreeAPI::validateTree, req, res);
+    });
+
+    // Range aggregates: all of them, or one by name. ?from= and ?to= bound
+    // the range inclusively; either may be left out for an open end.
+    server.Get("/api/tree/aggregate(?:/(sum|min|max|count))?", [this](const httplib::Request& req, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Aggregate, res);
+        try {
+            const TraceAggregate kind = aggregateKind(req.matches[1]);
+            std::optional<Key> from, to;
+            if (req.has_param("from")) from = ApiKey<Key>::fromPath(req.get_param_value("from"));
+            if (req.has_param("to")) to = ApiKey<Key>::fromPath(req.get_param_value("to"));
+            call.setRange(kind, from ? &*from : nullptr, to ? &*to : nullptr);
+            if (kind == TraceAggregate::Sum && !ApiKey<Key>::kHasSum) {
+                throw std::invalid_argument("sum needs integer keys");
+            }
+            if (!awaitVersion(req, res)) return;
+            auto response = aggregateRange(from ? &*from : nullptr, to ? &*to : nullptr, kind);
+            res.set_content(response.dump(), "application/json");
+        } catch (const std::exception& e) {
+            auto error = errorResponse("Invalid request: " + std::string(e.what()));
+            res.status = 400;
+            res.set_content(error.dump(), "application/json");
+        }
+    });
+
+    // Replication role and lag; never cached, lag moves without mutations
+    server.Get("/api/replication", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(replicationStatus().dump(), "application/json");
     });
 
     // Insert random node
     server.Post("/api/tree/random", [this](const httplib::Request&, httplib::Response& res) {
+        CapturedCall<Key> call(capture.get(), TraceOp::Random, res);
+        if (!acceptWrite(res)) return;
         auto response = insertRandom();
+        if (response["success"]) call.setKey(ApiKey<Key>::fromJson(response["data"]["value"]));
         res.set_content(response.dump(), "application/json");
     });
 }
 
-json TreeAPI::insertNode(int value) {
-    std::cout << "🔍 INSERT_NODE called with value: " << value << std::endl;
-    std::cout << "🔍 Current tree size before insert: " << tree->size() << std::endl;
+template<typename Key>
+json TreeAPI<Key>::insertNode(const Key& value, std::chrono::milliseconds ttl) {
+    std::cout << "🔍 INSERT_NODE called with value: " << ApiKey<Key>::toJson(value) << std::endl;
     
     try {
-        bool existed = tree->search(value);
+        InsertOp op{&value, ttl};
+        if (combineWrites) {
+            insertCombiner.execute(op, [this](std::vector<InsertOp*>& batch) { applyInserts(batch); });
+        } else {
+            std::vector<InsertOp*> batch{&op};
+            applyInserts(batch);
+        }
+        if (op.error) std::rethrow_exception(op.error);
         
-        if (existed) {
-            std::cout << "⚠️ Node " << value << " already exists" << std::endl;
+        if (op.existed) {
+            std::cout << "⚠️ Node " << ApiKey<Key>::toJson(value) << " already exists" << std::endl;
             return successResponse("Node already exists", {
-                {"value", value},
-                {"existed", true}
+                {"value", ApiKey<Key>::toJson(value)},
+                {"existed", true},
+                {"version", op.version}
             });
         }
-        
-        tree->insert(value);
-        std::cout << "✅ Node " << value << " inserted. New tree size: " << tree->size() << std::endl;
+        std::cout << "✅ Node " << ApiKey<Key>::toJson(value) << " inserted. New tree size: " << op.treeSize << std::endl;
         
         return successResponse("Node inserted successfully", {
-            {"value", value},
-            {"existed", false}
+            {"value", ApiKey<Key>::toJson(value)},
+            {"existed", false},
+            {"evicted", op.evicted},
+            {"version", op.version}
         });
         
     } catch (const std::exception& e) {
@@ -164,16 +656,64 @@ json TreeAPI::insertNode(int value) {
     }
 }
 
+template<typename Key>
+void TreeAPI<Key>::applyInserts(std::vector<InsertOp*>& batch) {
+    // In key order each descent runs down the path the previous one just
+    // warmed. Concurrent inserts may commit in any order, so this is still
+    // one of the orders the callers could have seen.
+    if (batch.size() > 1) {
+        std::sort(batch.begin(), batch.end(), [](const InsertOp* a, const InsertOp* b) {
+            return *a->value < *b->value;
+        });
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(treeMutex);
+    const auto now = KeyRetention<Key>::Clock::now();
+    bool changed = false;
+    for (InsertOp* op : batch) {
+        // One failed insert fails only its own caller; what the others
+        // (and any part of this one) changed is still committed below
+        try {
+            const Key& value = *op->value;
+            op->existed = !tree->insert(value);
+            if (op->existed) {
+                retention->refreshed(value, op->ttl, now);
+                continue;
+            }
+            changed = true;
+            recordLocked(ReplicaOp::Insert, value);
+            retention->added(value, entryBytes(value), op->ttl, now);
+            op->evicted = retention->evict([this](const Key& key) {
+                tree->remove(key);
+                recordLocked(ReplicaOp::Remove, key);
+                captureRemoval(TraceOp::Evict, key);
+            });
+        } catch (...) {
+            op->error = std::current_exception();
+        }
+    }
+    // One version (and one replicated commit) for the whole batch
+    if (changed) commitLocked();
+    for (InsertOp* op : batch) {
+        op->version = treeVersion.load();
+        op->treeSize = tree->size();
+    }
+}
 
-
-json TreeAPI::deleteNode(int value) {
+template<typename Key>
+json TreeAPI<Key>::deleteNode(const Key& value) {
     try {
+        std::unique_lock<std::shared_mutex> lock(treeMutex);
         bool removed = tree->remove(value);
         if (removed) {
+            retention->removed(value);
+            recordLocked(ReplicaOp::Remove, value);
+            commitLocked();
             return successResponse("Node deleted successfully", {
-                {"value", value},
-                {"tree", getTreeData()["data"]["tree"]},
-                {"stats", getTreeStats()["data"]}
+                {"value", ApiKey<Key>::toJson(value)},
+                {"version", treeVersion.load()},
+                {"tree", treeDataLocked()},
+                {"stats", treeStatsLocked()}
             });
         } else {
             return errorResponse("Node not found");
@@ -183,11 +723,14 @@ json TreeAPI::deleteNode(int value) {
     }
 }
 
-json TreeAPI::searchNode(int value) {
+template<typename Key>
+json TreeAPI<Key>::searchNode(const Key& value) {
     try {
-        bool found = tree->search(value);
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        bool found = tree->contains(value);
+        if (found) retention->touched(value);
         return successResponse("Search completed", {
-            {"value", value},
+            {"value", ApiKey<Key>::toJson(value)},
             {"found", found}
         });
     } catch (const std::exception& e) {
@@ -195,62 +738,188 @@ json TreeAPI::searchNode(int value) {
     }
 }
 
-json TreeAPI::getTreeData() {
+template<typename Key>
+json TreeAPI<Key>::getTreeData() {
     try {
-        auto nodes = tree->getAllNodes();
-        json nodeArray = json::array();
-        
-        for (auto node : nodes) {
-            if (node) {
-                nodeArray.push_back(nodeToJson(node));
-            }
-        }
-        
-        // Fixed: Use getters instead of direct access
-        json rootData = nullptr;
-        if (tree->getRoot() != tree->getNIL()) {
-            rootData = tree->getRoot()->data;
-        }
-        
+        std::unique_lock<std::shared_mutex> lock(treeMutex);
         return successResponse("Tree data retrieved", {
-            {"tree", {
-                {"nodes", nodeArray},
-                {"empty", tree->empty()},
-                {"root", rootData}
-            }}
+            {"tree", treeDataLocked()}
         });
     } catch (const std::exception& e) {
         return errorResponse("Failed to get tree data: " + std::string(e.what()));
     }
 }
 
-json TreeAPI::clearTree() {
+template<typename Key>
+json TreeAPI<Key>::aggregateRange(const Key* from, const Key* to, TraceAggregate kind) {
+    try {
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        // min and max point into the index, so they are read under the lock
+        const rbtree::KeyStats<Key> stats = tree->rangeStats(from, to);
+        auto keyOrNull = [](const Key* key) { return key ? ApiKey<Key>::toJson(*key) : json(nullptr); };
+        json data = {
+            {"from", keyOrNull(from)},
+            {"to", keyOrNull(to)},
+            {"indexed", tree->indexedRangeStats()},
+            {"engine", tree->engine()}
+        };
+        const bool all = kind == TraceAggregate::All;
+        if (all || kind == TraceAggregate::Count) data["count"] = stats.count;
+        if ((all && ApiKey<Key>::kHasSum) || kind == TraceAggregate::Sum) data["sum"] = ApiKey<Key>::sumToJson(stats.sum);
+        if (all || kind == TraceAggregate::Min) data["min"] = keyOrNull(stats.min);
+        if (all || kind == TraceAggregate::Max) data["max"] = keyOrNull(stats.max);
+        return successResponse("Aggregate computed", data);
+    } catch (const std::exception& e) {
+        return errorResponse("Aggregate failed: " + std::string(e.what()));
+    }
+}
+
+template<typename Key>
+json TreeAPI<Key>::treeDataLocked() {
+    if (auto* rb = tree->redBlackTree()) return drawTreeLocked(*rb);
+    if (auto* rb = tree->statsRedBlackTree()) return drawTreeLocked(*rb);
+
+    // No node shape to draw: send the keys in order instead
+    json keys = json::array();
+    tree->forEach([&keys](const Key& value) { keys.push_back(ApiKey<Key>::toJson(value)); });
+    return {
+        {"nodes", json::array()},
+        {"keys", keys},
+        {"empty", tree->empty()},
+        {"root", nullptr},
+        {"engine", tree->engine()}
+    };
+}
+
+template<typename Key>
+template<typename Tree>
+json TreeAPI<Key>::drawTreeLocked(Tree& rb) {
+    rb.updateLayout();
+    const auto* nil = rb.getNIL();
+    json nodeArray = json::array();
+
+    if (useParallel()) {
+        // Build the per-node objects in chunks, then splice them in order
+        auto nodes = rb.getAllNodes(*pool, parallelCutoff);
+        const size_t chunks = pool->parallelism() * 4;
+        const size_t chunkSize = (nodes.size() + chunks - 1) / chunks;
+        std::vector<json::array_t> parts(chunks);
+        rbtree::TaskGroup group(*pool);
+        for (size_t c = 0; c < chunks; c++) {
+            group.run([this, &nodes, &parts, nil, c, chunkSize] {
+                const size_t begin = std::min(nodes.size(), c * chunkSize);
+                const size_t end = std::min(nodes.size(), begin + chunkSize);
+                parts[c].reserve(end - begin);
+                for (size_t i = begin; i < end; i++) {
+                    parts[c].push_back(nodeToJson(nodes[i], nil));
+                }
+            });
+        }
+        group.wait();
+
+        auto& array = nodeArray.get_ref<json::array_t&>();
+        array.reserve(nodes.size());
+        for (auto& part : parts) {
+            std::move(part.begin(), part.end(), std::back_inserter(array));
+        }
+    } else {
+        auto nodes = rb.getAllNodes();
+        for (auto node : nodes) {
+            if (node) {
+                nodeArray.push_back(nodeToJson(node, nil));
+            }
+        }
+    }
+    
+    // Fixed: Use getters instead of direct access
+    json rootData = nullptr;
+    if (rb.getRoot() != rb.getNIL()) {
+        rootData = ApiKey<Key>::toJson(rb.getRoot()->data);
+    }
+    
+    return {
+        {"nodes", nodeArray},
+        {"empty", tree->empty()},
+        {"root", rootData},
+        {"engine", tree->engine()}
+    };
+}
+
+template<typename Key>
+json TreeAPI<Key>::clearTree() {
     try {
+        std::unique_lock<std::shared_mutex> lock(treeMutex);
         tree->clear();
+        retention->cleared();
+        recordLocked(ReplicaOp::Clear, Key());
+        commitLocked();
         return successResponse("Tree cleared successfully", {
-            {"stats", getTreeStats()["data"]}
+            {"version", treeVersion.load()},
+            {"stats", treeStatsLocked()}
         });
     } catch (const std::exception& e) {
         return errorResponse("Failed to clear tree: " + std::string(e.what()));
     }
 }
 
-json TreeAPI::getTreeStats() {
+template<typename Key>
+json TreeAPI<Key>::getTreeStats() {
     try {
-        return successResponse("Statistics retrieved", {
-            {"nodeCount", tree->size()},
-            {"height", tree->height()},
-            {"empty", tree->empty()},
-            {"valid", tree->isValidRBTree()}
-        });
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        return successResponse("Statistics retrieved", treeStatsLocked());
     } catch (const std::exception& e) {
         return errorResponse("Failed to get statistics: " + std::string(e.what()));
     }
 }
 
-json TreeAPI::validateTree() {
+template<typename Key>
+json TreeAPI<Key>::treeStatsLocked() {
+    return {
+        {"engine", tree->engine()},
+        {"nodeCount", tree->size()},
+        {"height", treeHeight()},
+        {"empty", tree->empty()},
+        {"valid", treeValid()}
+    };
+}
+
+template<typename Key>
+json TreeAPI<Key>::writeCombiningStats() const {
+    return {
+        {"enabled", combineWrites},
+        {"batches", insertCombiner.batches()},
+        {"inserts", insertCombiner.ops()}
+    };
+}
+
+template<typename Key>
+json TreeAPI<Key>::liveStats() {
+    std::shared_lock<std::shared_mutex> lock(treeMutex);
+    return {
+        {"retention", retentionStatsLocked()},
+        {"writeCombining", writeCombiningStats()}
+    };
+}
+
+template<typename Key>
+json TreeAPI<Key>::retentionStatsLocked() const {
+    const RetentionConfig& config = retention->config();
+    return {
+        {"tracked", retention->tracked()},
+        {"memoryBytes", retention->bytes()},
+        {"memoryCap", config.memoryCapBytes},
+        {"eviction", config.eviction == EvictionPolicy::Lru ? "lru" : "oldest"},
+        {"defaultTtlMs", config.defaultTtl.count()},
+        {"expired", retention->expiredTotal()},
+        {"evicted", retention->evictedTotal()}
+    };
+}
+
+template<typename Key>
+json TreeAPI<Key>::validateTree() {
     try {
-        bool valid = tree->isValidRBTree();
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        bool valid = treeValid();
         return successResponse("Validation completed", {
             {"valid", valid}
         });
@@ -259,7 +928,8 @@ json TreeAPI::validateTree() {
     }
 }
 
-json TreeAPI::insertRandom() {
+template<typename Key>
+json TreeAPI<Key>::insertRandom() {
     std::cout << "🎲 INSERT_RANDOM called" << std::endl;
     std::cout.flush(); // Force immediate output
     
@@ -268,8 +938,8 @@ json TreeAPI::insertRandom() {
         std::mt19937 gen(rd());
         std::uniform_int_distribution<> dis(1, 100);
         
-        int value = dis(gen);
-        std::cout << "🎲 Generated random value: " << value << std::endl;
+        Key value = ApiKey<Key>::fromNumber(dis(gen));
+        std::cout << "🎲 Generated random value: " << ApiKey<Key>::toJson(value) << std::endl;
         std::cout.flush();
         
         return insertNode(value);
@@ -280,23 +950,84 @@ json TreeAPI::insertRandom() {
 
 
 
-json TreeAPI::nodeToJson(rbtree::RBNode<int>* node) {
-    // Fixed: Use getters and proper null handling
-    if (!node || node == tree->getNIL()) return nullptr;
+template<typename Key>
+void TreeAPI<Key>::setCapture(std::shared_ptr<WorkloadTraceWriter> writer) {
+    capture = std::move(writer);
+}
+
+template<typename Key>
+void TreeAPI<Key>::setResponseCompression(bool enabled) {
+    if (enabled && !ResponseCache::gzipAvailable()) {
+        std::cout << "Response compression requested but built without zlib" << std::endl;
+        enabled = false;
+    }
+    compressResponses = enabled;
+}
+
+template<typename Key>
+void TreeAPI<Key>::serveCached(const std::string& endpoint, json (TreeAPI::*build)(),
+                          const httplib::Request& req, httplib::Response& res) {
+    // Read before building: the snapshot can only be newer than this, so an
+    // entry tagged with it is never served after a later mutation. On a
+    // follower applySnapshot() replaces both under the exclusive lock, so
+    // they are read as a pair; one epoch's generation with the other's
+    // version would match entries built from the wrong tree. Only a
+    // follower takes snapshots, so leader hits stay lock-free.
+    uint64_t generation, version;
+    {
+        std::shared_lock<std::shared_mutex> lock(treeMutex, std::defer_lock);
+        if (replicationFollower) lock.lock();
+        generation = responseCache.generation();
+        version = treeVersion.load();
+    }
+    auto body = responseCache.get(endpoint, version, generation, [this, build] {
+        return (this->*build)().dump();
+    });
+
+    const bool gzip = compressResponses &&
+                      req.get_header_value("Accept-Encoding").find("gzip") != std::string::npos;
+    if (gzip) {
+        auto compress = [&body] {
+            std::string out;
+            if (!ResponseCache::gzip(*body, out)) throw std::runtime_error("gzip failed");
+            return out;
+        };
+        ResponseCache::Bytes compressed;
+        try {
+            compressed = responseCache.get(endpoint + ":gzip", version, generation, compress);
+        } catch (const std::exception&) {
+            // Nothing is cached; the identity body below is still correct
+        }
+        res.set_header("Vary", "Accept-Encoding");
+        if (compressed) {
+            res.set_header("Content-Encoding", "gzip");
+            res.set_content(compressed->data(), compressed->size(), "application/json");
+            return;
+        }
+    }
+    res.set_content(body->data(), body->size(), "application/json");
+}
+
+
+template<typename Key>
+template<typename Node>
+json TreeAPI<Key>::nodeToJson(const Node* node, const Node* nil) {
+    if (!node || node == nil) return nullptr;
     
     return json{
-        {"data", node->data},
+        {"data", ApiKey<Key>::toJson(node->data)},
         {"color", node->isRed ? "red" : "black"},
         {"x", node->x},
         {"y", node->y},
         {"level", node->level},
-        {"left", node->left != tree->getNIL() ? json(node->left->data) : json(nullptr)},
-        {"right", node->right != tree->getNIL() ? json(node->right->data) : json(nullptr)},
-        {"parent", node->parent != nullptr ? json(node->parent->data) : json(nullptr)}
+        {"left", node->left != nil ? ApiKey<Key>::toJson(node->left->data) : json(nullptr)},
+        {"right", node->right != nil ? ApiKey<Key>::toJson(node->right->data) : json(nullptr)},
+        {"parent", node->parent != nullptr ? ApiKey<Key>::toJson(node->parent->data) : json(nullptr)}
     };
 }
 
-json TreeAPI::errorResponse(const std::string& message) {
+template<typename Key>
+json TreeAPI<Key>::errorResponse(const std::string& message) {
     return json{
         {"success", false},
         {"message", message},
@@ -305,7 +1036,8 @@ json TreeAPI::errorResponse(const std::string& message) {
     };
 }
 
-json TreeAPI::successResponse(const std::string& message, const json& data) {
+template<typename Key>
+json TreeAPI<Key>::successResponse(const std::string& message, const json& data) {
     return json{
         {"success", true},
         {"message", message},
@@ -314,3 +1046,10 @@ json TreeAPI::successResponse(const std::string& message, const json& data) {
             std::chrono::system_clock::now().time_since_epoch()).count()}
     };
 }
+
+template class TreeAPI<int64_t>;
+template class TreeAPI<rbtree::StringKey>;
+template void TreeAPI<int64_t>::setupRoutes<httplib::Server>(httplib::Server& server);
+template void TreeAPI<int64_t>::setupRoutes<EventLoopServer>(EventLoopServer& server);
+template void TreeAPI<rbtree::StringKey>::setupRoutes<httplib::Server>(httplib::Server& server);
+template void TreeAPI<rbtree::StringKey>::setupRoutes<EventLoopServer>(EventLoopServer& server);
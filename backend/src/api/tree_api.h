@@ -1,34 +1,186 @@
 #pragma once
-#include "../rbtree/tree.h"
+#include "../rbtree/flat_combining.h"
+#include "../rbtree/ordered_index.h"
+#include "../rbtree/string_key.h"
+#include "key_retention.h"
+#include "replication.h"
+#include "response_cache.h"
+#include "workload_trace.h"
 #include "json.hpp"
 #include "httplib.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 using json = nlohmann::json;
 
+class EventLoopServer;
+
+// Key is int64_t or rbtree::StringKey; both are instantiated in tree_api.cpp
+template<typename Key>
 class TreeAPI {
 private:
-    std::unique_ptr<rbtree::RedBlackTree<int>> tree;
+    // Any engine from rbtree::indexEngines(); only "rb" and "rb-stats" have
+    // drawable nodes
+    std::unique_ptr<rbtree::OrderedIndex<Key>> tree;
+
+    // Handlers run concurrently: lookups share the lock, mutations and
+    // layout (which writes node coordinates) take it exclusively
+    mutable std::shared_mutex treeMutex;
+
+    // Bumped under the exclusive lock by every mutation that changes the
+    // tree; read endpoints serve cached bytes built at the current version
+    std::atomic<uint64_t> treeVersion{1};
+    ResponseCache responseCache;
+    bool compressResponses = false;
+
+    // Every route call is appended here when capture is on
+    std::shared_ptr<WorkloadTraceWriter> capture;
+
+    // Whole-tree passes on large trees fork onto this pool
+    std::unique_ptr<rbtree::WorkStealingPool> pool;
+    int parallelCutoff;
+    static constexpr size_t kParallelMinNodes = 100000;
+
+    // TTLs and the memory cap; guarded by treeMutex like the tree itself.
+    // The expirer thread wakes every tick and removes due keys in batches,
+    // releasing the lock between batches so requests interleave.
+    std::unique_ptr<KeyRetention<Key>> retention;
+    std::thread expirer;
+    std::mutex expirerMutex;
+    std::condition_variable expirerWake;
+    bool expirerStopping = false;
+
+    // Replication. On a leader every commit's ops collect in pendingCommit
+    // (under the exclusive lock) and ship when the version is bumped. A
+    // follower applies the leader's stream and refuses writes.
+    std::unique_ptr<ReplicationLeader<Key>> replicationLeader;
+    std::unique_ptr<ReplicationFollower<Key>> replicationFollower;
+    ReplicaCommit<Key> pendingCommit;
+    // Readers asking for ?minVersion= wait here for the follower to catch
+    // up. Under the epoll front end they park on their loop instead, which
+    // runs them again when versionApplied() resumes it.
+    std::mutex versionMutex;
+    std::condition_variable versionAdvanced;
+    std::chrono::milliseconds readWait{1000};
+    std::atomic<EventLoopServer*> readLoops{nullptr};
+
+    // Inserts (including /api/tree/random) publish into the combiner, and
+    // one thread applies each batch sorted by key under a single exclusive
+    // lock and version bump. Off, each insert is a batch of one. An op
+    // that throws carries its exception back in error; the rest commit.
+    struct InsertOp {
+        const Key* value;
+        std::chrono::milliseconds ttl;
+        std::exception_ptr error{};
+        bool existed = false;
+        size_t evicted = 0;
+        uint64_t version = 0;
+        size_t treeSize = 0;
+    };
+    rbtree::FlatCombiner<InsertOp> insertCombiner;
+    bool combineWrites = true;
+    void applyInserts(std::vector<InsertOp*>& batch);
+
+    void recordLocked(ReplicaOp op, const Key& key);
+    void commitLocked();
+    ReplicaSnapshot<Key> snapshot();
+    void applySnapshot(ReplicaSnapshot<Key>&& snapshot);
+    void applyCommit(const ReplicaCommit<Key>& commit);
+    void versionApplied();
+    // Route guards; false means the response has been written
+    bool awaitVersion(const httplib::Request& req, httplib::Response& res);
+    bool acceptWrite(httplib::Response& res);
+
+    // Expiry and eviction removals go into the capture too, so a replay
+    // without this server's retention still ends at the same tree
+    void captureRemoval(TraceOp op, const Key& key);
+
+    void runExpirer();
+    size_t expireDue();
+    size_t entryBytes(const Key& value) const;
+    json retentionStatsLocked() const;
+    json writeCombiningStats() const;
+    // The counters that change without a version bump, so are kept out of
+    // the cached stats body and served by /api/tree/stats/live
+    json liveStats();
+
+    bool useParallel() const;
+    int treeHeight();
+    bool treeValid();
+
+    // Payload builders; the caller holds treeMutex
+    json treeDataLocked();
+    json treeStatsLocked();
+    template<typename Tree>
+    json drawTreeLocked(Tree& rb);
+
+    void serveCached(const std::string& endpoint, json (TreeAPI::*build)(),
+                     const httplib::Request& req, httplib::Response& res);
     
 public:
-    TreeAPI();
+    // Throws std::invalid_argument for an engine not in rbtree::indexEngines()
+    explicit TreeAPI(const std::string& engine = "rb", const RetentionConfig& retention = {});
+    ~TreeAPI();
+
+    TreeAPI(const TreeAPI&) = delete;
+    TreeAPI& operator=(const TreeAPI&) = delete;
+
+    // threads == 0 picks the hardware concurrency, cutoffDepth < 0 picks a
+    // depth that gives every thread several subtrees to steal.
+    void setParallelism(size_t threads, int cutoffDepth = -1);
+
+    // gzip cached responses for clients that accept it (needs zlib)
+    void setResponseCompression(bool enabled);
+    // Record every route call to a workload trace; call before setupRoutes()
+    void setCapture(std::shared_ptr<WorkloadTraceWriter> writer);
+    uint64_t version() const { return treeVersion.load(); }
+    const char* engine() const { return tree->engine(); }
+
+    // Stream every commit to followers connecting on port; false if it
+    // cannot be bound. logCommits is how far behind a follower may fall
+    // before it needs a full snapshot.
+    bool startReplicationLeader(int port, size_t logCommits);
+    // Mirror the leader at host:port and serve reads only
+    void startReplicationFollower(const std::string& host, int port);
+    // Longest a read with ?minVersion= waits before answering 503
+    void setReadWait(std::chrono::milliseconds wait) { readWait = wait; }
+    bool readOnly() const { return replicationFollower != nullptr; }
+    // Flat-combine concurrent inserts (the default) or lock once per insert
+    void setWriteCombining(bool enabled) { combineWrites = enabled; }
     
-    // Setup routes
-    void setupRoutes(httplib::Server& server);
+    // Setup routes on httplib::Server or EventLoopServer
+    template<typename Server>
+    void setupRoutes(Server& server);
     
     // API endpoints
-    json insertNode(int value);
-    json deleteNode(int value);
-    json searchNode(int value);
+    // ttl: KeyRetention::kDefaultTtl for the configured default, 0 for
+    // none. Re-inserting an existing key with an explicit ttl restarts it.
+    json insertNode(const Key& value, std::chrono::milliseconds ttl = KeyRetention<Key>::kDefaultTtl);
+    json deleteNode(const Key& value);
+    json searchNode(const Key& value);
     json getTreeData();
     json clearTree();
     json getTreeStats();
     json validateTree();
     json insertRandom();
+    // count/sum/min/max of the keys in [from, to]; a null bound is open.
+    // O(log n) on "rb-stats", an in-order scan on the other engines.
+    json aggregateRange(const Key* from, const Key* to, TraceAggregate kind = TraceAggregate::All);
+    // Role, versions and lag of this server and its followers or leader
+    json replicationStatus();
     
     // Utility methods
-    json nodeToJson(rbtree::RBNode<int>* node);
+    template<typename Node>
+    json nodeToJson(const Node* node, const Node* nil);
     json errorResponse(const std::string& message);
     json successResponse(const std::string& message, const json& data = json::object());
     
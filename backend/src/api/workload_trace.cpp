@@ -0,0 +1,254 @@
+#include "workload_trace.h"
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'R', 'B', 'T', 'T', 'R', 'A', 'C', 'E'};
+// Version 2 added Aggregate records, version 3 the Insert ttl and the
+// Expire/Evict records; older files still load
+constexpr uint8_t kFormatVersion = 3;
+constexpr uint8_t kFirstVersionWithTtl = 3;
+constexpr size_t kHeaderSize = 24;
+constexpr size_t kFlushBytes = 64 * 1024;
+constexpr uint8_t kHasKey = 0x80;
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putU64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint64_t getU64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+void putKey(std::vector<uint8_t>& out, TraceKeyType keyType, int64_t intKey, const std::string& stringKey) {
+    if (keyType == TraceKeyType::Int64) {
+        putVarint(out, zigzag(intKey));
+    } else {
+        putVarint(out, stringKey.size());
+        out.insert(out.end(), stringKey.begin(), stringKey.end());
+    }
+}
+
+struct Cursor {
+    const uint8_t* pos;
+    const uint8_t* end;
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos == end) return false;
+            const uint8_t byte = *pos++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool byte(uint8_t& value) {
+        if (pos == end) return false;
+        value = *pos++;
+        return true;
+    }
+
+    bool key(TraceKeyType keyType, int64_t& intKey, std::string& stringKey) {
+        uint64_t value;
+        if (!varint(value)) return false;
+        if (keyType == TraceKeyType::Int64) {
+            intKey = unzigzag(value);
+            return true;
+        }
+        if (value > static_cast<uint64_t>(end - pos)) return false;
+        stringKey.assign(reinterpret_cast<const char*>(pos), value);
+        pos += value;
+        return true;
+    }
+};
+
+} // namespace
+
+const char* traceOpName(TraceOp op) {
+    static const char* names[kTraceOpCount] = {
+        "health", "tree", "insert", "delete", "search", "clear", "stats", "validate", "random",
+        "aggregate", "expire", "evict"};
+    const size_t index = static_cast<size_t>(op);
+    return index < kTraceOpCount ? names[index] : "unknown";
+}
+
+const char* traceAggregateName(TraceAggregate aggregate) {
+    static const char* names[kTraceAggregateCount] = {"all", "sum", "min", "max", "count"};
+    const size_t index = static_cast<size_t>(aggregate);
+    return index < kTraceAggregateCount ? names[index] : "unknown";
+}
+
+std::unique_ptr<WorkloadTraceWriter> WorkloadTraceWriter::open(const std::string& path, TraceKeyType keyType) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return nullptr;
+
+    uint8_t header[kHeaderSize] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    header[8] = kFormatVersion;
+    header[9] = static_cast<uint8_t>(keyType);
+    const auto wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    putU64(header + 16, static_cast<uint64_t>(wallNs));
+    if (std::fwrite(header, 1, kHeaderSize, file) != kHeaderSize) {
+        std::fclose(file);
+        return nullptr;
+    }
+    return std::unique_ptr<WorkloadTraceWriter>(new WorkloadTraceWriter(file, keyType));
+}
+
+WorkloadTraceWriter::WorkloadTraceWriter(std::FILE* file, TraceKeyType keyType)
+    : file_(file), keyType_(keyType), start_(Clock::now()), lastFlush_(start_) {
+    buffer_.reserve(kFlushBytes + 256);
+}
+
+WorkloadTraceWriter::~WorkloadTraceWriter() {
+    flush();
+    std::fclose(file_);
+}
+
+uint64_t WorkloadTraceWriter::sinceStart(Clock::time_point t) const {
+    return t <= start_ ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(t - start_).count();
+}
+
+void WorkloadTraceWriter::append(const TraceRecord& record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer_.push_back(static_cast<uint8_t>(record.op) | (record.hasKey ? kHasKey : 0));
+    putVarint(buffer_, zigzag(static_cast<int64_t>(record.startNs - previousStart_)));
+    putVarint(buffer_, record.durationNs);
+    putVarint(buffer_, record.status);
+    const bool aggregate = record.op == TraceOp::Aggregate;
+    if (aggregate) {
+        buffer_.push_back(static_cast<uint8_t>(record.aggregate) | (record.hasUpperKey ? kHasKey : 0));
+    }
+    if (record.op == TraceOp::Insert) {
+        putVarint(buffer_, zigzag(record.ttlMs));
+    }
+    if (record.hasKey) {
+        putKey(buffer_, keyType_, record.intKey, record.stringKey);
+    }
+    if (aggregate && record.hasUpperKey) {
+        putKey(buffer_, keyType_, record.upperIntKey, record.upperStringKey);
+    }
+    previousStart_ = record.startNs;
+    records_++;
+
+    if (buffer_.size() >= kFlushBytes || Clock::now() - lastFlush_ >= std::chrono::seconds(1)) {
+        flushLocked();
+    }
+}
+
+void WorkloadTraceWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+}
+
+void WorkloadTraceWriter::tryFlush() {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (lock.owns_lock()) flushLocked();
+}
+
+void WorkloadTraceWriter::flushLocked() {
+    if (!buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+    std::fflush(file_);
+    lastFlush_ = Clock::now();
+}
+
+uint64_t WorkloadTraceWriter::records() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+}
+
+bool WorkloadTrace::load(const std::string& path, WorkloadTrace& trace, std::string& error) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    std::fclose(file);
+
+    if (data.size() < kHeaderSize || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        error = path + " is not a workload trace";
+        return false;
+    }
+    if (data[8] < 1 || data[8] > kFormatVersion || data[9] > static_cast<uint8_t>(TraceKeyType::String)) {
+        error = path + " has an unsupported trace format";
+        return false;
+    }
+    const uint8_t version = data[8];
+    trace.keyType = static_cast<TraceKeyType>(data[9]);
+    trace.captureStartUnixNs = getU64(data.data() + 16);
+    trace.records.clear();
+    trace.truncated = false;
+
+    Cursor in{data.data() + kHeaderSize, data.data() + data.size()};
+    uint64_t previousStart = 0;
+    while (in.pos != in.end) {
+        TraceRecord record;
+        const uint8_t head = *in.pos++;
+        uint64_t delta, duration, status;
+        if (!in.varint(delta) || !in.varint(duration) || !in.varint(status) ||
+            (head & ~kHasKey) >= kTraceOpCount) {
+            trace.truncated = true;
+            break;
+        }
+        record.op = static_cast<TraceOp>(head & ~kHasKey);
+        record.startNs = previousStart + static_cast<uint64_t>(unzigzag(delta));
+        record.durationNs = duration;
+        record.status = static_cast<uint16_t>(status);
+        record.hasKey = head & kHasKey;
+        bool ok = true;
+        if (record.op == TraceOp::Aggregate) {
+            uint8_t detail = 0;
+            ok = in.byte(detail) && (detail & ~kHasKey) < kTraceAggregateCount;
+            record.aggregate = static_cast<TraceAggregate>(detail & ~kHasKey);
+            record.hasUpperKey = detail & kHasKey;
+        }
+        if (ok && record.op == TraceOp::Insert && version >= kFirstVersionWithTtl) {
+            uint64_t ttl = 0;
+            ok = in.varint(ttl);
+            record.ttlMs = unzigzag(ttl);
+        }
+        if (ok && record.hasKey) {
+            ok = in.key(trace.keyType, record.intKey, record.stringKey);
+        }
+        if (ok && record.hasUpperKey) {
+            ok = in.key(trace.keyType, record.upperIntKey, record.upperStringKey);
+        }
+        if (!ok) {
+            trace.truncated = true;
+            break;
+        }
+        previousStart = record.startNs;
+        trace.records.push_back(std::move(record));
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Compact binary log of the calls that reached TreeAPI, for replaying a
+// production request stream against another build (tools/replay.cpp).
+//
+// Layout: a 24-byte header (magic "RBTTRACE", format version, key type,
+// capture start in Unix nanoseconds), then one record per call:
+//
+//   u8      op, with bit 7 set when a key follows
+//   varint  zigzag(start - previous record's start), nanoseconds
+//   varint  handler duration, nanoseconds
+//   varint  HTTP status
+//   u8      Aggregate only: the reduction, with bit 7 set when an upper key follows
+//   varint  Insert only: zigzag(ttl in ms), -1 for the server's default
+//   key     int64: zigzag varint; string: varint length + bytes
+//   key     Aggregate only: the upper bound
+//
+// Expire and Evict records are not calls: they log the keys the server
+// removed on its own (TTL expiry, the memory cap), with a zero duration, so
+// a replay without the server's retention still ends at the same tree.
+//
+// Records are appended when a call finishes, so starts are only roughly
+// ordered; the signed delta absorbs that. A typical record is 8-12 bytes.
+// Expire and Evict are appended at the removal itself, under the tree lock,
+// so they can precede the insert that caused an eviction, which is appended
+// once its response is ready. Their startNs is the removal time; a reader
+// wanting commit order places each after the calls that started before it.
+enum class TraceOp : uint8_t {
+    Health, Tree, Insert, Delete, Search, Clear, Stats, Validate, Random, Aggregate, Expire, Evict
+};
+constexpr size_t kTraceOpCount = 12;
+const char* traceOpName(TraceOp op);
+// False for the server's own removals, which have no latency to report
+constexpr bool traceOpIsCall(TraceOp op) { return op != TraceOp::Expire && op != TraceOp::Evict; }
+
+// What an Aggregate call asked for: All is /api/tree/aggregate, the rest
+// are /api/tree/aggregate/<name>
+enum class TraceAggregate : uint8_t { All, Sum, Min, Max, Count };
+constexpr size_t kTraceAggregateCount = 5;
+const char* traceAggregateName(TraceAggregate aggregate);
+
+enum class TraceKeyType : uint8_t { Int64 = 0, String = 1 };
+
+struct TraceRecord {
+    TraceOp op = TraceOp::Health;
+    uint16_t status = 200;
+    uint64_t startNs = 0;     // since the capture started
+    uint64_t durationNs = 0;
+    bool hasKey = false;
+    int64_t intKey = 0;       // TraceKeyType::Int64
+    std::string stringKey;    // TraceKeyType::String
+    int64_t ttlMs = -1;       // TraceOp::Insert: the request's ttl, -1 when it gave none
+
+    // TraceOp::Aggregate: the key above is the range's lower bound (absent
+    // when open) and this is its upper bound
+    TraceAggregate aggregate = TraceAggregate::All;
+    bool hasUpperKey = false;
+    int64_t upperIntKey = 0;
+    std::string upperStringKey;
+};
+
+class WorkloadTraceWriter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // nullptr if the file cannot be created
+    static std::unique_ptr<WorkloadTraceWriter> open(const std::string& path, TraceKeyType keyType);
+    ~WorkloadTraceWriter();
+
+    WorkloadTraceWriter(const WorkloadTraceWriter&) = delete;
+    WorkloadTraceWriter& operator=(const WorkloadTraceWriter&) = delete;
+
+    TraceKeyType keyType() const { return keyType_; }
+    // Capture-relative nanoseconds for a record's startNs
+    uint64_t sinceStart(Clock::time_point t) const;
+
+    // Thread-safe. Buffers in memory and writes out every 64 KiB or second.
+    void append(const TraceRecord& record);
+    void flush();
+    // For signal handlers: skips the flush if a handler holds the lock
+    void tryFlush();
+    uint64_t records() const;
+
+private:
+    WorkloadTraceWriter(std::FILE* file, TraceKeyType keyType);
+    void flushLocked();
+
+    std::FILE* file_;
+    const TraceKeyType keyType_;
+    const Clock::time_point start_;
+    Clock::time_point lastFlush_;
+
+    mutable std::mutex mutex_;
+    std::vector<uint8_t> buffer_;
+    uint64_t previousStart_ = 0;
+    uint64_t records_ = 0;
+};
+
+struct WorkloadTrace {
+    TraceKeyType keyType = TraceKeyType::Int64;
+    uint64_t captureStartUnixNs = 0;
+    std::vector<TraceRecord> records;  // in file order
+    // The file ended inside a record (e.g. the server died mid-write);
+    // `records` holds everything before it
+    bool truncated = false;
+
+    // Returns false and sets `error` for a missing or foreign file
+    static bool load(const std::string& path, WorkloadTrace& trace, std::string& error);
+};
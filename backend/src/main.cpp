@@ -1,18 +1,27 @@
 #include "httplib.h"
 #include "api/tree_api.h"
+#include "server/event_loop_server.h"
+#include "server/server_config.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <signal.h>
 #include <cstdlib>
+#include <memory>
 #include <string>
 
-// Global server pointer for signal handling
+// Global server pointers for signal handling (only one is in use)
 httplib::Server* server_ptr = nullptr;
+EventLoopServer* event_server_ptr = nullptr;
+WorkloadTraceWriter* capture_ptr = nullptr;
 
 void signalHandler(int signal) {
-    if (server_ptr) {
+    if (server_ptr || event_server_ptr) {
         std::cout << "\nShutting down server..." << std::endl;
-        server_ptr->stop();
     }
+    if (server_ptr) server_ptr->stop();
+    if (event_server_ptr) event_server_ptr->stop();
+    if (capture_ptr) capture_ptr->tryFlush();
     exit(signal);
 }
 
@@ -22,31 +31,123 @@ int main() {
     std::cout << "🚀 YOU SHOULD SEE THIS MESSAGE!" << std::endl;
     std::cout << "========================================" << std::endl;
     
+    // Get environment variables
+    const ServerConfig config = ServerConfig::fromEnvironment();
+    const int PORT = config.port;
+    const bool useEventLoop = config.frontend == "epoll";
+    if (!useEventLoop && config.frontend != "threaded") {
+        std::cerr << "Unknown RBT_FRONTEND '" << config.frontend
+                  << "' (expected 'threaded' or 'epoll')" << std::endl;
+        return 1;
+    }
+    const auto& engines = rbtree::indexEngines();
+    if (std::find(engines.begin(), engines.end(), config.engine) == engines.end()) {
+        std::cerr << "Unknown RBT_ENGINE '" << config.engine
+                  << "' (expected one of " << rbtree::indexEngineNames(", ") << ")" << std::endl;
+        return 1;
+    }
+    const bool stringKeys = config.keyType == "string";
+    if (!stringKeys && config.keyType != "int64") {
+        std::cerr << "Unknown RBT_KEY_TYPE '" << config.keyType
+                  << "' (expected 'int64' or 'string')" << std::endl;
+        return 1;
+    }
+    if (config.eviction != "lru" && config.eviction != "oldest") {
+        std::cerr << "Unknown RBT_EVICTION '" << config.eviction
+                  << "' (expected 'lru' or 'oldest')" << std::endl;
+        return 1;
+    }
+    std::string leaderHost;
+    int leaderPort = 0;
+    if (!config.replicateFrom.empty()) {
+        const size_t colon = config.replicateFrom.rfind(':');
+        if (colon != std::string::npos && colon > 0) {
+            leaderHost = config.replicateFrom.substr(0, colon);
+            leaderPort = std::atoi(config.replicateFrom.c_str() + colon + 1);
+        }
+        if (leaderPort <= 0 || leaderPort > 65535) {
+            std::cerr << "Invalid RBT_REPLICATE_FROM '" << config.replicateFrom
+                      << "' (expected host:port)" << std::endl;
+            return 1;
+        }
+        if (config.replicationPort > 0) {
+            std::cerr << "RBT_REPLICATE_FROM and RBT_REPLICATION_PORT are exclusive;"
+                      << " followers do not relay" << std::endl;
+            return 1;
+        }
+    }
+
+    std::shared_ptr<WorkloadTraceWriter> capture;
+    if (!config.captureFile.empty()) {
+        capture = WorkloadTraceWriter::open(config.captureFile,
+                                            stringKeys ? TraceKeyType::String : TraceKeyType::Int64);
+        if (!capture) {
+            std::cerr << "Cannot create RBT_CAPTURE file '" << config.captureFile << "'" << std::endl;
+            return 1;
+        }
+        capture_ptr = capture.get();
+    }
+
     httplib::Server server;
-    server_ptr = &server;
+    EventLoopServer eventServer;
+    if (useEventLoop) {
+        config.apply(eventServer);
+        event_server_ptr = &eventServer;
+    } else {
+        config.apply(server);
+        server_ptr = &server;
+    }
     
     // Setup signal handlers
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
     
-    // Get environment variables
-    const char* port_env = std::getenv("PORT");
-    const int PORT = port_env ? std::atoi(port_env) : 8080;
-    
     const char* env = std::getenv("NODE_ENV");
     const bool isProduction = env && std::string(env) == "production";
     
-    TreeAPI treeAPI;
-    
-    // Clear tree on startup (temporary for debugging)
-    if (!isProduction) {
-        std::cout << "Clearing tree on server startup..." << std::endl;
-        treeAPI.clearTree();
-        std::cout << "Tree cleared." << std::endl;
+    // One API per key type; only the configured one is built
+    std::unique_ptr<TreeAPI<int64_t>> intAPI;
+    std::unique_ptr<TreeAPI<rbtree::StringKey>> stringAPI;
+    auto start = [&](auto& treeAPI) {
+        treeAPI.setParallelism(config.parallelThreads, config.parallelCutoff);
+        treeAPI.setReadWait(std::chrono::milliseconds(config.readWaitMs));
+        treeAPI.setWriteCombining(config.writeCombining);
+        treeAPI.setResponseCompression(config.gzipResponses);
+        treeAPI.setCapture(capture);
+        
+        // Clear tree on startup (temporary for debugging)
+        if (!isProduction) {
+            std::cout << "Clearing tree on server startup..." << std::endl;
+            treeAPI.clearTree();
+            std::cout << "Tree cleared." << std::endl;
+        }
+
+        // After the startup clear, so followers only ever see served state
+        if (config.replicationPort > 0 &&
+            !treeAPI.startReplicationLeader(config.replicationPort, config.replicationLog)) {
+            return false;
+        }
+        if (leaderPort > 0) {
+            treeAPI.startReplicationFollower(leaderHost, leaderPort);
+        }
+        
+        // Setup API routes (ONLY ONCE)
+        if (useEventLoop) {
+            treeAPI.setupRoutes(eventServer);
+        } else {
+            treeAPI.setupRoutes(server);
+        }
+        return true;
+    };
+    bool apiReady;
+    if (stringKeys) {
+        stringAPI = std::make_unique<TreeAPI<rbtree::StringKey>>(config.engine, config.retention());
+        apiReady = start(*stringAPI);
+    } else {
+        intAPI = std::make_unique<TreeAPI<int64_t>>(config.engine, config.retention());
+        apiReady = start(*intAPI);
     }
-    
-    // Setup API routes (ONLY ONCE)
-    treeAPI.setupRoutes(server);
+    if (!apiReady) return 1;
     
     // REMOVED: Static file serving (not needed for backend-only deployment)
     // server.set_mount_point("/", "../frontend/public");
@@ -55,6 +156,7 @@ int main() {
     std::cout << "================================" << std::endl;
     std::cout << "Environment: " << (isProduction ? "Production" : "Development") << std::endl;
     std::cout << "Server starting on port " << PORT << std::endl;
+    config.print();
     std::cout << "API Base URL: http://0.0.0.0:" << PORT << "/api" << std::endl;
     std::cout << std::endl;
     std::cout << "Available endpoints:" << std::endl;
@@ -65,14 +167,19 @@ int main() {
     std::cout << "  GET    /api/tree/search/:id  - Search node" << std::endl;
     std::cout << "  POST   /api/tree/clear       - Clear tree" << std::endl;
     std::cout << "  GET    /api/tree/stats       - Get statistics" << std::endl;
+    std::cout << "  GET    /api/tree/stats/live  - Retention and write counters" << std::endl;
     std::cout << "  GET    /api/tree/validate    - Validate tree" << std::endl;
     std::cout << "  POST   /api/tree/random      - Insert random" << std::endl;
+    std::cout << "  GET    /api/tree/aggregate   - Range count/sum/min/max" << std::endl;
+    std::cout << "  GET    /api/replication      - Replication status" << std::endl;
     std::cout << std::endl;
     std::cout << "Press Ctrl+C to stop the server" << std::endl;
     std::cout << "================================" << std::endl;
     
     // Start server
-    if (!server.listen("0.0.0.0", PORT)) {
+    const bool started = useEventLoop ? eventServer.listen("0.0.0.0", PORT)
+                                      : server.listen("0.0.0.0", PORT);
+    if (!started) {
         std::cerr << "Failed to start server on port " << PORT << std::endl;
         return 1;
     }
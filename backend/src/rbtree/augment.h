@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+namespace rbtree {
+
+// Subtree augmentation policies for RedBlackTree<T, Augment>.
+//
+// A policy is a monoid over per-node summaries. Every node caches the
+// summary of its subtree, which the tree keeps current through rotations
+// and the insert/delete fixups, so aggregate(from, to) runs in O(log n).
+//
+//   static constexpr bool enabled = true;
+//   using value_type = ...;
+//   static value_type identity();
+//   static value_type fromKey(const T& key);  // key is the node's own data
+//   static value_type combine(const value_type& left, const value_type& right);
+//
+// combine must be associative with identity() as its unit. It is always
+// called with left's keys ordered before right's, so it need not commute.
+// value_type must support == so isValidRBTree() can check cached summaries.
+
+// The default: no summary is stored and no maintenance code is generated
+struct NoAugment {
+    static constexpr bool enabled = false;
+    using value_type = void;
+};
+
+// Storage for a node's subtree summary; empty (and folded away by the empty
+// base optimization) when the policy is disabled
+template<typename Augment, bool = Augment::enabled>
+struct AugmentSlot {
+    typename Augment::value_type summary;
+    AugmentSlot() : summary(Augment::identity()) {}
+};
+
+template<typename Augment>
+struct AugmentSlot<Augment, false> {};
+
+template<typename T>
+struct CountAugment {
+    static constexpr bool enabled = true;
+    using value_type = size_t;
+    static value_type identity() { return 0; }
+    static value_type fromKey(const T&) { return 1; }
+    static value_type combine(value_type left, value_type right) { return left + right; }
+};
+
+// Sum type wide enough that int64 keys cannot overflow in any tree that
+// fits in memory; keys without arithmetic get an empty placeholder
+template<typename T, bool = std::is_integral<T>::value, bool = std::is_floating_point<T>::value>
+struct KeySum {
+    static constexpr bool exists = false;
+    struct type {
+        bool operator==(const type&) const { return true; }
+    };
+    static type of(const T&) { return {}; }
+    static type add(type, type) { return {}; }
+};
+
+template<typename T>
+struct KeySum<T, true, false> {
+    static constexpr bool exists = true;
+    using type = __int128;
+    static type of(const T& key) { return static_cast<type>(key); }
+    static type add(type a, type b) { return a + b; }
+};
+
+template<typename T>
+struct KeySum<T, false, true> {
+    static constexpr bool exists = true;
+    using type = long double;
+    static type of(const T& key) { return static_cast<type>(key); }
+    static type add(type a, type b) { return a + b; }
+};
+
+template<typename T>
+struct SumAugment {
+    static_assert(KeySum<T>::exists, "SumAugment needs arithmetic keys");
+    static constexpr bool enabled = true;
+    using value_type = typename KeySum<T>::type;
+    static value_type identity() { return 0; }
+    static value_type fromKey(const T& key) { return KeySum<T>::of(key); }
+    static value_type combine(value_type left, value_type right) { return left + right; }
+};
+
+// count, sum, min and max in one summary. min and max point at the keys of
+// the subtree's leftmost and rightmost nodes (which combine's ordering makes
+// free to track), so the summary stays small for any key type; they are
+// nullptr when count is 0.
+template<typename T>
+struct KeyStats {
+    size_t count = 0;
+    typename KeySum<T>::type sum{};
+    const T* min = nullptr;
+    const T* max = nullptr;
+
+    bool operator==(const KeyStats& other) const {
+        return count == other.count && sum == other.sum &&
+               min == other.min && max == other.max;
+    }
+};
+
+template<typename T>
+struct KeyStatsAugment {
+    static constexpr bool enabled = true;
+    using value_type = KeyStats<T>;
+    static value_type identity() { return {}; }
+    static value_type fromKey(const T& key) {
+        return {1, KeySum<T>::of(key), &key, &key};
+    }
+    static value_type combine(const value_type& left, const value_type& right) {
+        return {left.count + right.count,
+                KeySum<T>::add(left.sum, right.sum),
+                left.min ? left.min : right.min,
+                right.max ? right.max : left.max};
+    }
+};
+
+} // namespace rbtree
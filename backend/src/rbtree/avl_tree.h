@@ -0,0 +1,65 @@
+#pragma once
+#include "traversal.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+
+namespace rbtree {
+
+template<typename T>
+struct AVLNode {
+    T data;
+    AVLNode* left;
+    AVLNode* right;
+    int height;  // 1 for a leaf
+
+    explicit AVLNode(const T& value)
+        : data(value), left(nullptr), right(nullptr), height(1) {}
+};
+
+// Height-balanced BST: subtrees of every node differ in height by at most
+// one, so it is shallower than a red-black tree (<= 1.44 log2 n) at the cost
+// of more rotations on update. Children are plain nullptr (no sentinel) and
+// there are no parent pointers; updates recurse down and rebalance on the
+// way back up.
+template<typename T>
+class AVLTree {
+private:
+    AVLNode<T>* root;
+    size_t nodeCount;
+
+    static int heightOf(const AVLNode<T>* node) { return node ? node->height : 0; }
+    static void updateHeight(AVLNode<T>* node);
+    static AVLNode<T>* rotateLeft(AVLNode<T>* x);
+    static AVLNode<T>* rotateRight(AVLNode<T>* x);
+    static AVLNode<T>* rebalance(AVLNode<T>* node);
+    AVLNode<T>* insertAt(AVLNode<T>* node, const T& value, bool& inserted);
+    AVLNode<T>* removeAt(AVLNode<T>* node, const T& value, bool& removed);
+    AVLNode<T>* removeMin(AVLNode<T>* node, AVLNode<T>*& min);
+    bool validateNode(const AVLNode<T>* node, const T* lo, const T* hi, int& height) const;
+
+public:
+    AVLTree() : root(nullptr), nodeCount(0) {}
+    ~AVLTree() { clear(); }
+
+    AVLTree(const AVLTree&) = delete;
+    AVLTree& operator=(const AVLTree&) = delete;
+
+    // Both return false when nothing changed (duplicate / missing key)
+    bool insert(const T& value);
+    bool remove(const T& value);
+    bool search(const T& value) const;
+    void clear();
+    template<typename Visit>
+    void inorder(Visit&& visit) const;
+
+    bool empty() const { return root == nullptr; }
+    size_t size() const { return nodeCount; }
+    int height() const { return heightOf(root); }
+    bool isValidAVLTree() const;
+    AVLNode<T>* getRoot() const { return root; }
+};
+
+} // namespace rbtree
+
+#include "avl_tree.tpp"
@@ -0,0 +1,174 @@
+#pragma once
+#include "avl_tree.h"
+
+namespace rbtree {
+
+template<typename T>
+void AVLTree<T>::updateHeight(AVLNode<T>* node) {
+    node->height = 1 + std::max(heightOf(node->left), heightOf(node->right));
+}
+
+template<typename T>
+AVLNode<T>* AVLTree<T>::rotateLeft(AVLNode<T>* x) {
+    AVLNode<T>* y = x->right;
+    x->right = y->left;
+    y->left = x;
+    updateHeight(x);
+    updateHeight(y);
+    return y;
+}
+
+template<typename T>
+AVLNode<T>* AVLTree<T>::rotateRight(AVLNode<T>* x) {
+    AVLNode<T>* y = x->left;
+    x->left = y->right;
+    y->right = x;
+    updateHeight(x);
+    updateHeight(y);
+    return y;
+}
+
+template<typename T>
+AVLNode<T>* AVLTree<T>::rebalance(AVLNode<T>* node) {
+    updateHeight(node);
+    const int balance = heightOf(node->left) - heightOf(node->right);
+    if (balance > 1) {
+        if (heightOf(node->left->left) < heightOf(node->left->right)) {
+            node->left = rotateLeft(node->left);
+        }
+        return rotateRight(node);
+    }
+    if (balance < -1) {
+        if (heightOf(node->right->right) < heightOf(node->right->left)) {
+            node->right = rotateRight(node->right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+template<typename T>
+bool AVLTree<T>::insert(const T& value) {
+    bool inserted = false;
+    root = insertAt(root, value, inserted);
+    if (inserted) nodeCount++;
+    return inserted;
+}
+
+template<typename T>
+AVLNode<T>* AVLTree<T>::insertAt(AVLNode<T>* node, const T& value, bool& inserted) {
+    if (node == nullptr) {
+        inserted = true;
+        return new AVLNode<T>(value);
+    }
+    if (value < node->data) {
+        node->left = insertAt(node->left, value, inserted);
+    } else if (node->data < value) {
+        node->right = insertAt(node->right, value, inserted);
+    } else {
+        return node;
+    }
+    // Nothing below changed shape, so nothing above needs rebalancing
+    return inserted ? rebalance(node) : node;
+}
+
+template<typename T>
+bool AVLTree<T>::remove(const T& value) {
+    bool removed = false;
+    root = removeAt(root, value, removed);
+    if (removed) nodeCount--;
+    return removed;
+}
+
+template<typename T>
+AVLNode<T>* AVLTree<T>::removeAt(AVLNode<T>* node, const T& value, bool& removed) {
+    if (node == nullptr) return nullptr;
+    if (value < node->data) {
+        node->left = removeAt(node->left, value, removed);
+    } else if (node->data < value) {
+        node->right = removeAt(node->right, value, removed);
+    } else {
+        removed = true;
+        AVLNode<T>* left = node->left;
+        AVLNode<T>* right = node->right;
+        delete node;
+        if (right == nullptr) return left;
+        // Replace with the in-order successor, relinking it rather than
+        // copying its key
+        AVLNode<T>* successor = nullptr;
+        right = removeMin(right, successor);
+        successor->left = left;
+        successor->right = right;
+        return rebalance(successor);
+    }
+    return removed ? rebalance(node) : node;
+}
+
+template<typename T>
+AVLNode<T>* AVLTree<T>::removeMin(AVLNode<T>* node, AVLNode<T>*& min) {
+    if (node->left == nullptr) {
+        min = node;
+        return node->right;
+    }
+    node->left = removeMin(node->left, min);
+    return rebalance(node);
+}
+
+template<typename T>
+bool AVLTree<T>::search(const T& value) const {
+    const AVLNode<T>* current = root;
+    while (current != nullptr) {
+        if (value == current->data) return true;
+        if (value < current->data) {
+            current = current->left;
+        } else {
+            current = current->right;
+        }
+    }
+    return false;
+}
+
+template<typename T>
+void AVLTree<T>::clear() {
+    struct Deleter : TraversalVisitor {
+        void post(AVLNode<T>* n) { delete n; }
+    } deleter;
+    eulerTour<AVLNode<T>>(root, nullptr, deleter);
+    root = nullptr;
+    nodeCount = 0;
+}
+
+template<typename T>
+template<typename Visit>
+void AVLTree<T>::inorder(Visit&& visit) const {
+    auto onNode = [&visit](const AVLNode<T>* n) { visit(n->data); };
+    inorderWalk<AVLNode<T>>(root, nullptr, onNode);
+}
+
+template<typename T>
+bool AVLTree<T>::isValidAVLTree() const {
+    int height = 0;
+    if (!validateNode(root, nullptr, nullptr, height)) return false;
+    size_t count = 0;
+    inorder([&count](const T&) { count++; });
+    return count == nodeCount;
+}
+
+template<typename T>
+bool AVLTree<T>::validateNode(const AVLNode<T>* node, const T* lo, const T* hi, int& height) const {
+    // Recursion depth is the tree height, which AVL keeps under 1.44 log2 n
+    if (node == nullptr) {
+        height = 0;
+        return true;
+    }
+    if ((lo && !(*lo < node->data)) || (hi && !(node->data < *hi))) return false;
+    int leftHeight = 0;
+    int rightHeight = 0;
+    if (!validateNode(node->left, lo, &node->data, leftHeight)) return false;
+    if (!validateNode(node->right, &node->data, hi, rightHeight)) return false;
+    if (std::abs(leftHeight - rightHeight) > 1) return false;
+    height = 1 + std::max(leftHeight, rightHeight);
+    return height == node->height;
+}
+
+} // namespace rbtree
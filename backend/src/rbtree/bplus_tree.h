@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace rbtree {
+
+// In-memory B+-tree with wide nodes.
+//
+// Keys sit in sorted arrays of up to Fanout entries per node, so a lookup
+// touches about log_Fanout(n) nodes and each node is a few contiguous cache
+// lines instead of one pointer chase per key. Every key lives in a leaf;
+// inner nodes only hold separators, and the leaves are chained for in-order
+// scans. Separators may outlive the key they were copied from; they only
+// need to route: children[i] holds keys in [keys[i-1], keys[i]).
+template<typename T, size_t Fanout = 64>
+class BPlusTree {
+    static_assert(Fanout >= 4, "B+-tree nodes need room to split and merge");
+
+public:
+    static constexpr size_t kMaxKeys = Fanout;
+    static constexpr size_t kMinKeys = Fanout / 2;
+
+private:
+    struct Node {
+        bool leaf;
+        uint16_t count;
+        explicit Node(bool isLeaf) : leaf(isLeaf), count(0) {}
+    };
+    // One spare slot lets a node overflow before it splits
+    struct Leaf : Node {
+        T keys[kMaxKeys + 1];
+        Leaf* next = nullptr;
+        Leaf() : Node(true) {}
+    };
+    struct Inner : Node {
+        T keys[kMaxKeys + 1];
+        Node* children[kMaxKeys + 2];
+        Inner() : Node(false) {}
+    };
+
+    Node* root;
+    size_t keyCount;
+    int levels;
+
+    static Leaf* asLeaf(Node* node) { return static_cast<Leaf*>(node); }
+    static Inner* asInner(Node* node) { return static_cast<Inner*>(node); }
+    static size_t childIndex(const Inner* node, const T& value);
+    static void destroy(Node* node);
+
+    bool insertAt(Node* node, const T& value, T& upKey, Node*& upNode);
+    bool removeAt(Node* node, const T& value);
+    void fixUnderflow(Inner* parent, size_t index);
+    Leaf* firstLeaf() const;
+    bool validateNode(Node* node, const T* lo, const T* hi, int depth, int& leafDepth) const;
+
+public:
+    BPlusTree() : root(new Leaf()), keyCount(0), levels(1) {}
+    ~BPlusTree() { destroy(root); }
+
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    // Both return false when nothing changed (duplicate / missing key)
+    bool insert(const T& value);
+    bool remove(const T& value);
+    bool search(const T& value) const;
+    void clear();
+    template<typename Visit>
+    void inorder(Visit&& visit) const;
+
+    bool empty() const { return keyCount == 0; }
+    size_t size() const { return keyCount; }
+    // Levels from root to leaf; 0 when empty
+    int height() const { return keyCount == 0 ? 0 : levels; }
+    bool isValid() const;
+};
+
+} // namespace rbtree
+
+#include "bplus_tree.tpp"
@@ -0,0 +1,288 @@
+#pragma once
+#include "bplus_tree.h"
+
+namespace rbtree {
+
+template<typename T, size_t Fanout>
+size_t BPlusTree<T, Fanout>::childIndex(const Inner* node, const T& value) {
+    return std::upper_bound(node->keys, node->keys + node->count, value) - node->keys;
+}
+
+template<typename T, size_t Fanout>
+void BPlusTree<T, Fanout>::destroy(Node* node) {
+    // Recursion depth is the number of levels (a handful even at 10^9 keys)
+    if (node->leaf) {
+        delete asLeaf(node);
+        return;
+    }
+    Inner* inner = asInner(node);
+    for (size_t i = 0; i <= inner->count; i++) destroy(inner->children[i]);
+    delete inner;
+}
+
+template<typename T, size_t Fanout>
+void BPlusTree<T, Fanout>::clear() {
+    destroy(root);
+    root = new Leaf();
+    keyCount = 0;
+    levels = 1;
+}
+
+template<typename T, size_t Fanout>
+bool BPlusTree<T, Fanout>::search(const T& value) const {
+    Node* node = root;
+    while (!node->leaf) {
+        Inner* inner = asInner(node);
+        node = inner->children[childIndex(inner, value)];
+    }
+    const Leaf* leaf = asLeaf(node);
+    const T* end = leaf->keys + leaf->count;
+    const T* pos = std::lower_bound(leaf->keys, end, value);
+    return pos != end && !(value < *pos);
+}
+
+template<typename T, size_t Fanout>
+bool BPlusTree<T, Fanout>::insert(const T& value) {
+    T upKey;
+    Node* upNode = nullptr;
+    if (!insertAt(root, value, upKey, upNode)) return false;
+    keyCount++;
+    if (upNode) {
+        Inner* newRoot = new Inner();
+        newRoot->keys[0] = upKey;
+        newRoot->children[0] = root;
+        newRoot->children[1] = upNode;
+        newRoot->count = 1;
+        root = newRoot;
+        levels++;
+    }
+    return true;
+}
+
+// Inserts below `node`. If `node` split, its new right sibling and the
+// separator for it come back through upNode / upKey.
+template<typename T, size_t Fanout>
+bool BPlusTree<T, Fanout>::insertAt(Node* node, const T& value, T& upKey, Node*& upNode) {
+    if (node->leaf) {
+        Leaf* leaf = asLeaf(node);
+        T* end = leaf->keys + leaf->count;
+        T* pos = std::lower_bound(leaf->keys, end, value);
+        if (pos != end && !(value < *pos)) return false;
+        std::move_backward(pos, end, end + 1);
+        *pos = value;
+        if (++leaf->count <= kMaxKeys) return true;
+
+        Leaf* right = new Leaf();
+        const size_t keep = leaf->count / 2;
+        std::move(leaf->keys + keep, leaf->keys + leaf->count, right->keys);
+        right->count = leaf->count - keep;
+        leaf->count = keep;
+        right->next = leaf->next;
+        leaf->next = right;
+        upKey = right->keys[0];
+        upNode = right;
+        return true;
+    }
+
+    Inner* inner = asInner(node);
+    const size_t index = childIndex(inner, value);
+    T childKey;
+    Node* childSplit = nullptr;
+    if (!insertAt(inner->children[index], value, childKey, childSplit)) return false;
+    if (!childSplit) return true;
+
+    std::move_backward(inner->keys + index, inner->keys + inner->count,
+                       inner->keys + inner->count + 1);
+    std::move_backward(inner->children + index + 1, inner->children + inner->count + 1,
+                       inner->children + inner->count + 2);
+    inner->keys[index] = childKey;
+    inner->children[index + 1] = childSplit;
+    if (++inner->count <= kMaxKeys) return true;
+
+    // The middle separator moves up; it is not kept in either half
+    Inner* right = new Inner();
+    const size_t mid = inner->count / 2;
+    std::move(inner->keys + mid + 1, inner->keys + inner->count, right->keys);
+    std::copy(inner->children + mid + 1, inner->children + inner->count + 1, right->children);
+    right->count = inner->count - mid - 1;
+    upKey = inner->keys[mid];
+    inner->count = mid;
+    upNode = right;
+    return true;
+}
+
+template<typename T, size_t Fanout>
+bool BPlusTree<T, Fanout>::remove(const T& value) {
+    if (!removeAt(root, value)) return false;
+    keyCount--;
+    if (!root->leaf && root->count == 0) {
+        Inner* oldRoot = asInner(root);
+        root = oldRoot->children[0];
+        delete oldRoot;
+        levels--;
+    }
+    return true;
+}
+
+template<typename T, size_t Fanout>
+bool BPlusTree<T, Fanout>::removeAt(Node* node, const T& value) {
+    if (node->leaf) {
+        Leaf* leaf = asLeaf(node);
+        T* end = leaf->keys + leaf->count;
+        T* pos = std::lower_bound(leaf->keys, end, value);
+        if (pos == end || value < *pos) return false;
+        std::move(pos + 1, end, pos);
+        leaf->count--;
+        return true;
+    }
+
+    Inner* inner = asInner(node);
+    const size_t index = childIndex(inner, value);
+    if (!removeAt(inner->children[index], value)) return false;
+    if (inner->children[index]->count < kMinKeys) fixUnderflow(inner, index);
+    return true;
+}
+
+// children[index] of parent dropped below kMinKeys: borrow one key from a
+// sibling that can spare it, otherwise merge with a sibling.
+template<typename T, size_t Fanout>
+void BPlusTree<T, Fanout>::fixUnderflow(Inner* parent, size_t index) {
+    Node* child = parent->children[index];
+    Node* left = index > 0 ? parent->children[index - 1] : nullptr;
+    Node* right = index < parent->count ? parent->children[index + 1] : nullptr;
+
+    if (child->leaf) {
+        Leaf* c = asLeaf(child);
+        if (left && left->count > kMinKeys) {
+            Leaf* l = asLeaf(left);
+            std::move_backward(c->keys, c->keys + c->count, c->keys + c->count + 1);
+            c->keys[0] = std::move(l->keys[--l->count]);
+            c->count++;
+            parent->keys[index - 1] = c->keys[0];
+            return;
+        }
+        if (right && right->count > kMinKeys) {
+            Leaf* r = asLeaf(right);
+            c->keys[c->count++] = std::move(r->keys[0]);
+            std::move(r->keys + 1, r->keys + r->count, r->keys);
+            r->count--;
+            parent->keys[index] = r->keys[0];
+            return;
+        }
+    } else {
+        Inner* c = asInner(child);
+        if (left && left->count > kMinKeys) {
+            Inner* l = asInner(left);
+            std::move_backward(c->keys, c->keys + c->count, c->keys + c->count + 1);
+            std::move_backward(c->children, c->children + c->count + 1,
+                               c->children + c->count + 2);
+            c->keys[0] = std::move(parent->keys[index - 1]);
+            c->children[0] = l->children[l->count];
+            c->count++;
+            parent->keys[index - 1] = std::move(l->keys[--l->count]);
+            return;
+        }
+        if (right && right->count > kMinKeys) {
+            Inner* r = asInner(right);
+            c->keys[c->count] = std::move(parent->keys[index]);
+            c->children[c->count + 1] = r->children[0];
+            c->count++;
+            parent->keys[index] = std::move(r->keys[0]);
+            std::move(r->keys + 1, r->keys + r->count, r->keys);
+            std::move(r->children + 1, r->children + r->count + 1, r->children);
+            r->count--;
+            return;
+        }
+    }
+
+    // Neither sibling can spare a key: fold the right one of the pair into
+    // the left one and drop the separator between them
+    const size_t at = left ? index - 1 : index;
+    Node* into = parent->children[at];
+    Node* from = parent->children[at + 1];
+    if (into->leaf) {
+        Leaf* a = asLeaf(into);
+        Leaf* b = asLeaf(from);
+        std::move(b->keys, b->keys + b->count, a->keys + a->count);
+        a->count += b->count;
+        a->next = b->next;
+        delete b;
+    } else {
+        Inner* a = asInner(into);
+        Inner* b = asInner(from);
+        a->keys[a->count] = std::move(parent->keys[at]);
+        std::move(b->keys, b->keys + b->count, a->keys + a->count + 1);
+        std::copy(b->children, b->children + b->count + 1, a->children + a->count + 1);
+        a->count += b->count + 1;
+        delete b;
+    }
+    std::move(parent->keys + at + 1, parent->keys + parent->count, parent->keys + at);
+    std::move(parent->children + at + 2, parent->children + parent->count + 1,
+              parent->children + at + 1);
+    parent->count--;
+}
+
+template<typename T, size_t Fanout>
+typename BPlusTree<T, Fanout>::Leaf* BPlusTree<T, Fanout>::firstLeaf() const {
+    Node* node = root;
+    while (!node->leaf) node = asInner(node)->children[0];
+    return asLeaf(node);
+}
+
+template<typename T, size_t Fanout>
+template<typename Visit>
+void BPlusTree<T, Fanout>::inorder(Visit&& visit) const {
+    for (const Leaf* leaf = firstLeaf(); leaf; leaf = leaf->next) {
+        if (leaf->next) __builtin_prefetch(leaf->next);
+        for (size_t i = 0; i < leaf->count; i++) visit(leaf->keys[i]);
+    }
+}
+
+template<typename T, size_t Fanout>
+bool BPlusTree<T, Fanout>::isValid() const {
+    int leafDepth = -1;
+    if (!validateNode(root, nullptr, nullptr, 1, leafDepth)) return false;
+    if (leafDepth != levels) return false;
+
+    // The leaf chain must visit every key once, in strictly increasing order
+    size_t count = 0;
+    const T* previous = nullptr;
+    bool ordered = true;
+    inorder([&](const T& key) {
+        if (previous && !(*previous < key)) ordered = false;
+        previous = &key;
+        count++;
+    });
+    return ordered && count == keyCount;
+}
+
+template<typename T, size_t Fanout>
+bool BPlusTree<T, Fanout>::validateNode(Node* node, const T* lo, const T* hi, int depth,
+                                        int& leafDepth) const {
+    if (node != root && node->count < kMinKeys) return false;
+    if (node->count > kMaxKeys) return false;
+
+    const T* keys = node->leaf ? asLeaf(node)->keys : asInner(node)->keys;
+    for (size_t i = 0; i < node->count; i++) {
+        if (i > 0 && !(keys[i - 1] < keys[i])) return false;
+        if (lo && keys[i] < *lo) return false;
+        if (hi && !(keys[i] < *hi)) return false;
+    }
+
+    if (node->leaf) {
+        if (leafDepth < 0) leafDepth = depth;
+        return leafDepth == depth;
+    }
+    Inner* inner = asInner(node);
+    if (node == root && inner->count == 0) return false;
+    for (size_t i = 0; i <= inner->count; i++) {
+        const T* childLo = i > 0 ? &inner->keys[i - 1] : lo;
+        const T* childHi = i < inner->count ? &inner->keys[i] : hi;
+        if (!validateNode(inner->children[i], childLo, childHi, depth + 1, leafDepth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace rbtree
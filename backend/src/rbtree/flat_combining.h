@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace rbtree {
+
+// Flat combining for short mutations of a structure behind one lock.
+//
+// Rather than every thread taking the lock for its own tiny operation, a
+// caller publishes the operation in a slot and waits. Whichever waiter finds
+// no combiner running becomes the combiner: it collects every published
+// operation and applies them as one batch, so the lock and the top of the
+// structure stay in one core's cache while the other callers spin on their
+// own request instead of on the lock. Callers arriving during a batch are
+// picked up by the next pass.
+//
+// Op carries both the request and its result and stays on the caller's stack
+// for the whole of execute(). Each thread has a home slot, so with no more
+// threads than slots every thread effectively owns one; a caller that finds
+// every slot taken keeps retrying until one frees up or it can combine.
+template<typename Op>
+class FlatCombiner {
+public:
+    using Batch = std::vector<Op*>;
+
+    explicit FlatCombiner(size_t slots = 64) : slots_(slots == 0 ? 1 : slots) {}
+
+    FlatCombiner(const FlatCombiner&) = delete;
+    FlatCombiner& operator=(const FlatCombiner&) = delete;
+
+    // Returns once some thread has run apply(batch) over a batch holding op.
+    // apply runs on one thread at a time, must fill in every op's result and
+    // may reorder the batch; if it throws, every op in that batch rethrows.
+    template<typename Apply>
+    void execute(Op& op, Apply&& apply) {
+        Request request;
+        request.op = &op;
+        // Uncontended, the caller combines straight away without publishing
+        bool published = false;
+        for (unsigned spins = 0; !request.done.load(std::memory_order_acquire); spins++) {
+            if (!combining_.load(std::memory_order_relaxed) &&
+                !combining_.exchange(true, std::memory_order_acquire)) {
+                // An unpublished request rides along with the first pass
+                combine(apply, published ? nullptr : &request);
+                combining_.store(false, std::memory_order_release);
+                continue;
+            }
+            if (!published) published = publish(request);
+            if (spins >= kSpins) std::this_thread::yield();
+        }
+        if (request.error) std::rethrow_exception(request.error);
+    }
+
+    size_t slots() const { return slots_.size(); }
+    uint64_t batches() const { return batches_.load(std::memory_order_relaxed); }
+    uint64_t ops() const { return ops_.load(std::memory_order_relaxed); }
+
+private:
+    struct Request {
+        Op* op = nullptr;
+        std::exception_ptr error;
+        std::atomic<bool> done{false};
+    };
+    // One cache line each, so publishing never bounces a neighbour's slot
+    struct alignas(64) Slot {
+        std::atomic<Request*> request{nullptr};
+    };
+
+    // Passes a combiner makes before handing the role back; later arrivals
+    // fold into the running batch instead of waiting for the lock
+    static constexpr int kPasses = 3;
+    static constexpr unsigned kSpins = 64;
+
+    static size_t threadIndex() {
+        static std::atomic<size_t> next{0};
+        thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    bool publish(Request& request) {
+        const size_t n = slots_.size();
+        const size_t home = threadIndex() % n;
+        for (size_t k = 0; k < n; k++) {
+            const size_t index = (home + k) % n;
+            // Raised before the slot fills, so this thread's own combine
+            // pass always scans far enough to find it
+            size_t used = used_.load(std::memory_order_relaxed);
+            while (used <= index && !used_.compare_exchange_weak(used, index + 1, std::memory_order_relaxed)) {}
+            Request* expected = nullptr;
+            if (slots_[index].request.compare_exchange_strong(
+                    expected, &request, std::memory_order_release, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename Apply>
+    void combine(Apply& apply, Request* own) {
+        for (int pass = 0; pass < kPasses; pass++) {
+            requests_.clear();
+            if (own) {
+                requests_.push_back(own);
+                own = nullptr;
+            }
+            // Only the combiner empties slots, so a non-null load stays ours.
+            // A request past a stale `used` is served by its own caller.
+            const size_t used = used_.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < used; i++) {
+                Slot& slot = slots_[i];
+                if (slot.request.load(std::memory_order_relaxed)) {
+                    requests_.push_back(slot.request.exchange(nullptr, std::memory_order_acquire));
+                }
+            }
+            if (requests_.empty()) return;
+
+            batch_.clear();
+            for (Request* request : requests_) batch_.push_back(request->op);
+            std::exception_ptr error;
+            try {
+                apply(batch_);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            // Only the combiner writes these
+            batches_.store(batches_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            ops_.store(ops_.load(std::memory_order_relaxed) + requests_.size(), std::memory_order_relaxed);
+            // done last: the caller's stack frame may be gone right after
+            for (Request* request : requests_) {
+                request->error = error;
+                request->done.store(true, std::memory_order_release);
+            }
+        }
+    }
+
+    std::vector<Slot> slots_;
+    // Slots below this have been published to; the combiner scans no further
+    alignas(64) std::atomic<size_t> used_{0};
+    alignas(64) std::atomic<bool> combining_{false};
+    // Scratch for the combiner, reused across batches
+    std::vector<Request*> requests_;
+    Batch batch_;
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> ops_{0};
+};
+
+} // namespace rbtree
@@ -1,9 +1,13 @@
 #pragma once
+#include "augment.h"
+#include <utility>
 
 namespace rbtree {
 
-template<typename T>
-struct RBNode {
+// Augment adds a cached subtree summary (see augment.h); with the default
+// NoAugment the node layout is exactly the unaugmented one
+template<typename T, typename Augment = NoAugment>
+struct RBNode : AugmentSlot<Augment> {
     T data;
     RBNode* left;
     RBNode* right;
@@ -17,6 +21,9 @@ struct RBNode {
     RBNode(const T& value, bool red = true) 
         : data(value), left(nullptr), right(nullptr), 
           parent(nullptr), isRed(red), x(0), y(0), level(0) {}
+    RBNode(T&& value, bool red = true)
+        : data(std::move(value)), left(nullptr), right(nullptr),
+          parent(nullptr), isRed(red), x(0), y(0), level(0) {}
 };
 
 } // namespace rbtree
@@ -0,0 +1,177 @@
+#pragma once
+#include "tree.h"
+#include "avl_tree.h"
+#include "bplus_tree.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rbtree {
+
+// Engine-neutral view of an ordered set of keys, so TreeAPI (and the
+// benchmarks) can run the same workload on any of the index structures.
+// insert/remove report whether the set changed.
+template<typename T>
+class OrderedIndex {
+public:
+    virtual ~OrderedIndex() = default;
+
+    virtual const char* engine() const = 0;
+    virtual bool insert(const T& value) = 0;
+    virtual bool remove(const T& value) = 0;
+    virtual bool contains(const T& value) const = 0;
+    virtual void clear() = 0;
+    virtual size_t size() const = 0;
+    bool empty() const { return size() == 0; }
+
+    // Engine-specific shape checks: colours for RB, balance for AVL, fill
+    // and uniform leaf depth for the B+-tree. height() counts nodes on the
+    // longest root-to-leaf path.
+    virtual int height() const = 0;
+    virtual bool validate() const = 0;
+    virtual void forEach(const std::function<void(const T&)>& visit) const = 0;
+    // Rough index footprint of one key (node plus allocator header, or a
+    // B+ slot at typical fill), not counting heap data the key owns
+    virtual size_t bytesPerKey() const = 0;
+
+    // Engines with fork-join passes override these
+    virtual int height(WorkStealingPool&, int) const { return height(); }
+    virtual bool validate(WorkStealingPool&, int) const { return validate(); }
+
+    // count/sum/min/max of the keys in [from, to]; a null bound is open.
+    // O(log n) where indexedRangeStats(), an in-order scan elsewhere. min and
+    // max point into the index and are valid until the next mutation.
+    virtual KeyStats<T> rangeStats(const T* from, const T* to) const {
+        KeyStats<T> stats;
+        forEach([&stats, from, to](const T& key) {
+            if ((from && key < *from) || (to && *to < key)) return;
+            stats = KeyStatsAugment<T>::combine(stats, KeyStatsAugment<T>::fromKey(key));
+        });
+        return stats;
+    }
+    virtual bool indexedRangeStats() const { return false; }
+
+    // Node-level visualization is only drawn for the red-black engines
+    virtual RedBlackTree<T>* redBlackTree() { return nullptr; }
+    virtual RedBlackTree<T, KeyStatsAugment<T>>* statsRedBlackTree() { return nullptr; }
+};
+
+// "rb", or "rb-stats" with KeyStatsAugment: subtree summaries make
+// rangeStats() logarithmic at the cost of maintaining them on every update
+template<typename T, typename Augment = NoAugment>
+class RedBlackIndex : public OrderedIndex<T> {
+    static constexpr bool kStats = std::is_same<Augment, KeyStatsAugment<T>>::value;
+
+public:
+    const char* engine() const override { return kStats ? "rb-stats" : "rb"; }
+    bool insert(const T& value) override {
+        const size_t before = tree.size();
+        tree.insert(value);
+        return tree.size() != before;
+    }
+    bool remove(const T& value) override { return tree.remove(value); }
+    bool contains(const T& value) const override { return tree.search(value); }
+    void clear() override { tree.clear(); }
+    size_t size() const override { return tree.size(); }
+    int height() const override { return tree.height(); }
+    bool validate() const override { return tree.isValidRBTree(); }
+    void forEach(const std::function<void(const T&)>& visit) const override { tree.inorder(visit); }
+    size_t bytesPerKey() const override { return sizeof(typename RedBlackTree<T, Augment>::Node) + 16; }
+    int height(WorkStealingPool& pool, int cutoffDepth) const override {
+        return tree.height(pool, cutoffDepth);
+    }
+    bool validate(WorkStealingPool& pool, int cutoffDepth) const override {
+        return tree.isValidRBTree(pool, cutoffDepth);
+    }
+    KeyStats<T> rangeStats(const T* from, const T* to) const override {
+        if constexpr (kStats) {
+            return tree.aggregate(from, to);
+        } else {
+            return OrderedIndex<T>::rangeStats(from, to);
+        }
+    }
+    bool indexedRangeStats() const override { return kStats; }
+    RedBlackTree<T>* redBlackTree() override {
+        if constexpr (kStats) {
+            return nullptr;
+        } else {
+            return &tree;
+        }
+    }
+    RedBlackTree<T, KeyStatsAugment<T>>* statsRedBlackTree() override {
+        if constexpr (kStats) {
+            return &tree;
+        } else {
+            return nullptr;
+        }
+    }
+
+private:
+    RedBlackTree<T, Augment> tree;
+};
+
+template<typename T>
+class AVLIndex : public OrderedIndex<T> {
+public:
+    const char* engine() const override { return "avl"; }
+    bool insert(const T& value) override { return tree.insert(value); }
+    bool remove(const T& value) override { return tree.remove(value); }
+    bool contains(const T& value) const override { return tree.search(value); }
+    void clear() override { tree.clear(); }
+    size_t size() const override { return tree.size(); }
+    int height() const override { return tree.height(); }
+    bool validate() const override { return tree.isValidAVLTree(); }
+    void forEach(const std::function<void(const T&)>& visit) const override { tree.inorder(visit); }
+    size_t bytesPerKey() const override { return sizeof(AVLNode<T>) + 16; }
+
+private:
+    AVLTree<T> tree;
+};
+
+template<typename T>
+class BPlusIndex : public OrderedIndex<T> {
+public:
+    const char* engine() const override { return "bplus"; }
+    bool insert(const T& value) override { return tree.insert(value); }
+    bool remove(const T& value) override { return tree.remove(value); }
+    bool contains(const T& value) const override { return tree.search(value); }
+    void clear() override { tree.clear(); }
+    size_t size() const override { return tree.size(); }
+    int height() const override { return tree.height(); }
+    bool validate() const override { return tree.isValid(); }
+    void forEach(const std::function<void(const T&)>& visit) const override { tree.inorder(visit); }
+    // Leaves run between half and completely full
+    size_t bytesPerKey() const override { return sizeof(T) * 3 / 2; }
+
+private:
+    BPlusTree<T> tree;
+};
+
+inline const std::vector<std::string>& indexEngines() {
+    static const std::vector<std::string> engines = {"rb", "avl", "bplus", "rb-stats"};
+    return engines;
+}
+
+// The names above joined by separator, for usage and error messages
+inline std::string indexEngineNames(const std::string& separator) {
+    std::string names;
+    for (const auto& engine : indexEngines()) {
+        if (!names.empty()) names += separator;
+        names += engine;
+    }
+    return names;
+}
+
+// nullptr for an unknown engine name
+template<typename T>
+std::unique_ptr<OrderedIndex<T>> makeOrderedIndex(const std::string& engine) {
+    if (engine == "rb") return std::make_unique<RedBlackIndex<T>>();
+    if (engine == "avl") return std::make_unique<AVLIndex<T>>();
+    if (engine == "bplus") return std::make_unique<BPlusIndex<T>>();
+    if (engine == "rb-stats") return std::make_unique<RedBlackIndex<T, KeyStatsAugment<T>>>();
+    return nullptr;
+}
+
+} // namespace rbtree
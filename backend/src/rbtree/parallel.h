@@ -0,0 +1,208 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rbtree {
+
+// Small work-stealing pool for fork-join passes over very large trees.
+//
+// Each worker owns a deque: it pushes and pops its own tasks at the back and
+// steals from the front of the others when it runs dry. A thread waiting on
+// a TaskGroup helps instead of blocking, so `parallelism` counts the caller:
+// a pool of parallelism N starts N-1 workers, and N == 1 runs everything
+// inline in wait().
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t parallelism)
+        : parallelism_(parallelism == 0 ? 1 : parallelism) {
+        const size_t workers = parallelism_ - 1;
+        queues_.reserve(workers + 1);
+        // One extra queue for tasks submitted by threads outside the pool.
+        for (size_t i = 0; i <= workers; i++) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < workers; i++) {
+            threads_.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t parallelism() const { return parallelism_; }
+
+    void submit(Task task) {
+        const size_t own = ownQueue();
+        Queue& q = *queues_[own == kExternal ? queues_.size() - 1 : own];
+        {
+            // Counted before it is visible so a thief can never decrement first.
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            queued_++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        wake_.notify_one();
+    }
+
+    // Runs one pending task if there is one: own queue first (newest), then
+    // steals the oldest task from any other queue.
+    bool runOne() {
+        Task task;
+        const size_t own = ownQueue();
+        if (own != kExternal && popBack(*queues_[own], task)) {
+            run(task);
+            return true;
+        }
+        const size_t n = queues_.size();
+        const size_t start = own == kExternal ? 0 : own + 1;
+        for (size_t k = 0; k < n; k++) {
+            const size_t victim = (start + k) % n;
+            if (victim != own && popFront(*queues_[victim], task)) {
+                run(task);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static constexpr size_t kExternal = static_cast<size_t>(-1);
+
+    size_t ownQueue() const {
+        return currentPool() == this ? currentIndex() : kExternal;
+    }
+
+    static const WorkStealingPool*& currentPool() {
+        static thread_local const WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+
+    static size_t& currentIndex() {
+        static thread_local size_t index = kExternal;
+        return index;
+    }
+
+    bool popBack(Queue& q, Task& out) {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) return false;
+        out = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool popFront(Queue& q, Task& out) {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) return false;
+        out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+
+    void run(Task& task) {
+        queued_--;
+        task();
+    }
+
+    void workerLoop(size_t index) {
+        currentPool() = this;
+        currentIndex() = index;
+        while (true) {
+            if (runOne()) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+            if (stopping_) return;
+        }
+    }
+
+    const size_t parallelism_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> queued_{0};
+    bool stopping_ = false;
+};
+
+// Fork-join scope: run() forks, wait() joins and rethrows the first failure.
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool& pool) : pool_(pool) {}
+    ~TaskGroup() { waitAll(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template<typename F>
+    void run(F&& f) {
+        outstanding_++;
+        pool_.submit([this, f = std::forward<F>(f)]() mutable {
+            try {
+                f();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex_);
+                if (!error_) error_ = std::current_exception();
+            }
+            // Under the lock; waitAll() takes it once more before returning,
+            // so the group outlives this notify
+            std::lock_guard<std::mutex> lock(doneMutex_);
+            if (--outstanding_ == 0) done_.notify_all();
+        });
+    }
+
+    void wait() {
+        waitAll();
+        if (error_) {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    // Helps while there is anything to steal, then sleeps until the last
+    // running task finishes instead of spinning a core
+    void waitAll() {
+        while (outstanding_.load() > 0) {
+            if (pool_.runOne()) continue;
+            std::unique_lock<std::mutex> lock(doneMutex_);
+            done_.wait(lock, [this] { return outstanding_.load() == 0; });
+        }
+        std::lock_guard<std::mutex> lock(doneMutex_);
+    }
+
+    WorkStealingPool& pool_;
+    std::atomic<size_t> outstanding_{0};
+    std::mutex doneMutex_;
+    std::condition_variable done_;
+    std::mutex errorMutex_;
+    std::exception_ptr error_;
+};
+
+} // namespace rbtree
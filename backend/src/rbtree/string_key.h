@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <utility>
+
+namespace rbtree {
+
+// String key that keeps its first 8 bytes inline as a big-endian integer.
+//
+// Comparisons check the prefixes first, with one integer compare on memory
+// the node already holds. Only keys that share all 8 leading bytes fall
+// through to the string bytes, which live on the heap for anything past the
+// SSO limit. Ordering matches std::string (bytewise, unsigned), so a tree of
+// StringKey iterates in the same order as a tree of std::string.
+class StringKey {
+public:
+    static constexpr size_t kPrefixBytes = sizeof(uint64_t);
+
+    StringKey() = default;
+    StringKey(std::string value) : prefix_(pack(value)), value_(std::move(value)) {}
+    StringKey(const char* value) : StringKey(std::string(value)) {}
+
+    const std::string& str() const { return value_; }
+    uint64_t prefix() const { return prefix_; }
+
+    friend bool operator<(const StringKey& a, const StringKey& b) {
+        if (a.prefix_ != b.prefix_) return a.prefix_ < b.prefix_;
+        // Equal prefixes: compare the bytes past the prefix, then lengths.
+        // A string shorter than the prefix has matched the other one's
+        // leading bytes and zero padding, so it sorts first.
+        const size_t shorter = std::min(a.value_.size(), b.value_.size());
+        if (shorter > kPrefixBytes) {
+            const int c = std::memcmp(a.value_.data() + kPrefixBytes, b.value_.data() + kPrefixBytes,
+                                      shorter - kPrefixBytes);
+            if (c != 0) return c < 0;
+        }
+        return a.value_.size() < b.value_.size();
+    }
+    friend bool operator==(const StringKey& a, const StringKey& b) {
+        const size_t size = a.value_.size();
+        return a.prefix_ == b.prefix_ && size == b.value_.size() &&
+               (size <= kPrefixBytes ||
+                std::memcmp(a.value_.data() + kPrefixBytes, b.value_.data() + kPrefixBytes,
+                            size - kPrefixBytes) == 0);
+    }
+    friend bool operator!=(const StringKey& a, const StringKey& b) { return !(a == b); }
+    friend bool operator>(const StringKey& a, const StringKey& b) { return b < a; }
+    friend bool operator<=(const StringKey& a, const StringKey& b) { return !(b < a); }
+    friend bool operator>=(const StringKey& a, const StringKey& b) { return !(a < b); }
+
+private:
+    static uint64_t pack(const std::string& s) {
+        uint64_t prefix = 0;
+        for (size_t i = 0; i < kPrefixBytes; i++) {
+            prefix = (prefix << 8) | (i < s.size() ? static_cast<unsigned char>(s[i]) : 0u);
+        }
+        return prefix;
+    }
+
+    uint64_t prefix_ = 0;
+    std::string value_;
+};
+
+// Quoted and escaped, for RedBlackTree::toJSON()
+inline void writeJsonKey(std::ostream& out, const StringKey& key) {
+    out << '"';
+    for (unsigned char c : key.str()) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace rbtree
+
+// For hashed side tables keyed like the index (e.g. TTL bookkeeping)
+namespace std {
+template<>
+struct hash<rbtree::StringKey> {
+    size_t operator()(const rbtree::StringKey& key) const noexcept {
+        return hash<string>()(key.str());
+    }
+};
+} // namespace std
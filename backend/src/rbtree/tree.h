@@ -1,55 +1,163 @@
 #pragma once
 #include "node.h"
-#include <functional>
+#include "traversal.h"
+#include "parallel.h"
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <utility>
 
 namespace rbtree {
 
+// How toJSON() writes a key; key types that are not JSON numbers provide an
+// overload next to the type (see string_key.h)
 template<typename T>
+void writeJsonKey(std::ostream& out, const T& key) {
+    out << key;
+}
+
+// Augment is a subtree summary policy from augment.h. The default NoAugment
+// stores nothing and compiles every maintenance hook away.
+template<typename T, typename Augment = NoAugment>
 class RedBlackTree {
+public:
+    using Node = RBNode<T, Augment>;
+
+    // Owns a node unlinked by extract(), like std::set::node_type. The key can
+    // be changed through value(), and insert(NodeHandle&&) relinks the node
+    // into any tree of the same type without allocating. A handle that still
+    // holds its node when destroyed frees it.
+    class NodeHandle {
+    public:
+        NodeHandle() = default;
+        NodeHandle(NodeHandle&& other) noexcept : node(std::exchange(other.node, nullptr)) {}
+        NodeHandle& operator=(NodeHandle&& other) noexcept {
+            if (this != &other) {
+                delete node;
+                node = std::exchange(other.node, nullptr);
+            }
+            return *this;
+        }
+        ~NodeHandle() { delete node; }
+
+        bool empty() const { return node == nullptr; }
+        explicit operator bool() const { return node != nullptr; }
+        T& value() const { return node->data; }
+
+    private:
+        friend class RedBlackTree;
+        explicit NodeHandle(Node* n) : node(n) {}
+        Node* node = nullptr;
+    };
+
+    // insert(NodeHandle&&) hands the node back when the key is already present
+    struct InsertResult {
+        bool inserted;
+        NodeHandle node;
+    };
+
 private:
-    RBNode<T>* root;
-    RBNode<T>* NIL;
+    Node* root;
+    Node* NIL;
     size_t nodeCount;
     
     // Helper methods
-    void leftRotate(RBNode<T>* x);
-    void rightRotate(RBNode<T>* x);
-    void fixInsert(RBNode<T>* k);
-    void fixDelete(RBNode<T>* x);
-    void clearHelper(RBNode<T>* node);
-    void inorderHelper(RBNode<T>* node, std::function<void(const T&)> visit) const;
-    RBNode<T>* minimum(RBNode<T>* node) const;
-    void transplant(RBNode<T>* u, RBNode<T>* v);
-    void collectNodes(RBNode<T>* node, std::vector<RBNode<T>*>& nodes) const;
-    int heightHelper(RBNode<T>* node) const;
-    void calculatePositions(RBNode<T>* node, int level, int& position);
-    std::string nodeToJSON(RBNode<T>* node) const;
-    bool validateNode(RBNode<T>* node, int blackCount, int& blackHeight) const;
+    void leftRotate(Node* x);
+    void rightRotate(Node* x);
+    void fixInsert(Node* k);
+    void fixDelete(Node* x);
+    void clearHelper(Node* node);
+    Node* minimum(Node* node) const;
+    void transplant(Node* u, Node* v);
+    void collectNodes(Node* node, std::vector<Node*>& nodes) const;
+    int heightHelper(Node* node) const;
+    void calculatePositions(Node* node, int level, int& position);
+    void nodeToJSON(Node* node, std::ostream& out) const;
+    static void writeNodeOpen(const Node* node, std::ostream& out);
+    bool validateNode(Node* node, int blackCount, int& blackHeight) const;
+
+    // The node with this key, or NIL
+    Node* find(const T& value) const;
+    // Links a fresh or extracted node. With unique set, a key already in
+    // the tree leaves the node unlinked and returns false; otherwise the
+    // caller has ruled that out.
+    bool attach(Node* node, bool unique = false);
+    // Unlinks z and rebalances without freeing it
+    void detach(Node* z);
+
+    // Augmentation hooks, compiled away unless Augment::enabled. pull()
+    // recomputes one node's summary from its children; NIL keeps identity().
+    void pull(Node* node);
+    void pullToRoot(Node* node);
+    bool summaryHolds(const Node* node) const;
+    bool validateSummaries(Node* node) const;
+
+    // Fork-join support: the levels above cutoffDepth are unrolled into an
+    // ordered list of steps, and every subtree hanging below them becomes
+    // one task. Sequential results are reproduced by replaying the steps.
+    struct FrontierStep {
+        enum Kind { Pre, In, Post, Nil, Subtree } kind;
+        Node* node;
+        int depth;       // 1 for the root
+        int blackCount;  // black nodes strictly above this position
+    };
+    std::vector<FrontierStep> planFrontier(int cutoffDepth) const;
+    void planFrontier(Node* node, int depth, int blackCount, int cutoffDepth,
+                      std::vector<FrontierStep>& steps) const;
+    template<typename Work>
+    void forEachSubtree(WorkStealingPool& pool, const std::vector<FrontierStep>& steps,
+                        Work&& work) const;
 
 public:
     RedBlackTree();
     ~RedBlackTree();
     
     void insert(const T& value);
+    void insert(T&& value);
     bool remove(const T& value);
+
+    // Node transfer without allocation: extract() unlinks the node holding
+    // value (an empty handle if there is none), insert() relinks one, and
+    // merge() splices every node of other whose key is not already here,
+    // leaving the duplicates in other. Keys are never copied.
+    NodeHandle extract(const T& value);
+    InsertResult insert(NodeHandle&& handle);
+    void merge(RedBlackTree& other);
     bool search(const T& value) const;
     void clear();
-    void inorder(std::function<void(const T&)> visit) const;
+    template<typename Visit>
+    void inorder(Visit&& visit) const;
     
     //methods
     bool empty() const;
     size_t size() const;
     int height() const;
-    std::vector<RBNode<T>*> getAllNodes() const;
+    std::vector<Node*> getAllNodes() const;
+    // Layout is only needed for drawing, so it is computed on demand rather
+    // than after every insert/remove. Call before reading node x/y/level.
     void updateLayout();
     std::string toJSON() const;
     bool isValidRBTree() const;
+
+    // Augmented trees only: the combined summary of the keys in [from, to]
+    // in key order, in O(log n). A null bound leaves that side open, so
+    // aggregate(nullptr, nullptr) is the whole tree's summary.
+    typename Augment::value_type aggregate(const T* from, const T* to) const;
+    typename Augment::value_type aggregate(const T& from, const T& to) const {
+        return aggregate(&from, &to);
+    }
+
+    // Parallel versions of the whole-tree passes. Subtrees rooted below
+    // cutoffDepth run as tasks on pool; results are identical to the
+    // sequential calls above.
+    int height(WorkStealingPool& pool, int cutoffDepth) const;
+    bool isValidRBTree(WorkStealingPool& pool, int cutoffDepth) const;
+    std::vector<Node*> getAllNodes(WorkStealingPool& pool, int cutoffDepth) const;
+    std::string toJSON(WorkStealingPool& pool, int cutoffDepth) const;
     // yeh wala for helping in drawing cause without child and parent a wrong tree was being made  
-    RBNode<T>* getRoot() const { return root; }
-    RBNode<T>* getNIL() const { return NIL; }
+    Node* getRoot() const { return root; }
+    Node* getNIL() const { return NIL; }
 };
 
 } // namespace rbtree
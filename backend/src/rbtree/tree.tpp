@@ -3,9 +3,9 @@
 
 namespace rbtree {
 
-template<typename T>
-RedBlackTree<T>::RedBlackTree() {
-    NIL = new RBNode<T>(T(), false);  // Black sentinel node
+template<typename T, typename Augment>
+RedBlackTree<T, Augment>::RedBlackTree() {
+    NIL = new RBNode<T, Augment>(T(), false);  // Black sentinel node
     root = NIL;
     nodeCount = 0;
     
@@ -16,25 +16,25 @@ RedBlackTree<T>::RedBlackTree() {
     NIL->isRed = false;
 }
 
-template<typename T>
-RedBlackTree<T>::~RedBlackTree() {
+template<typename T, typename Augment>
+RedBlackTree<T, Augment>::~RedBlackTree() {
     clear();
     delete NIL;
 }
 
-template<typename T>
-bool RedBlackTree<T>::empty() const {
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::empty() const {
     return root == NIL;
 }
 
-template<typename T>
-size_t RedBlackTree<T>::size() const {
+template<typename T, typename Augment>
+size_t RedBlackTree<T, Augment>::size() const {
     return nodeCount;
 }
 
-template<typename T>
-void RedBlackTree<T>::leftRotate(RBNode<T>* x) {
-    RBNode<T>* y = x->right;
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::leftRotate(RBNode<T, Augment>* x) {
+    RBNode<T, Augment>* y = x->right;
     x->right = y->left;
     
     if (y->left != NIL) {
@@ -53,11 +53,15 @@ void RedBlackTree<T>::leftRotate(RBNode<T>* x) {
     
     y->left = x;
     x->parent = y;
+
+    // x is now y's child; y covers exactly the keys x used to
+    pull(x);
+    pull(y);
 }
 
-template<typename T>
-void RedBlackTree<T>::rightRotate(RBNode<T>* x) {
-    RBNode<T>* y = x->left;
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::rightRotate(RBNode<T, Augment>* x) {
+    RBNode<T, Augment>* y = x->left;
     x->left = y->right;
     
     if (y->right != NIL) {
@@ -76,23 +80,48 @@ void RedBlackTree<T>::rightRotate(RBNode<T>* x) {
     
     y->right = x;
     x->parent = y;
+
+    pull(x);
+    pull(y);
 }
 
-template<typename T>
-void RedBlackTree<T>::insert(const T& value) {
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::insert(const T& value) {
     // FIXED: Check for duplicates first to prevent unnecessary insertions
     if (search(value)) {
         return; // Don't insert duplicates
     }
-    
-    RBNode<T>* node = new RBNode<T>(value);
-    RBNode<T>* y = nullptr;
-    RBNode<T>* x = root;
+    attach(new RBNode<T, Augment>(value));
+}
+
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::insert(T&& value) {
+    if (search(value)) {
+        return;
+    }
+    attach(new RBNode<T, Augment>(std::move(value)));
+}
+
+template<typename T, typename Augment>
+typename RedBlackTree<T, Augment>::InsertResult RedBlackTree<T, Augment>::insert(NodeHandle&& handle) {
+    if (handle.empty() || !attach(handle.node, true)) {
+        return {false, std::move(handle)};
+    }
+    handle.node = nullptr;
+    return {true, NodeHandle()};
+}
+
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::attach(RBNode<T, Augment>* node, bool unique) {
+    RBNode<T, Augment>* y = nullptr;
+    RBNode<T, Augment>* x = root;
 
     while (x != NIL) {
         y = x;
         if (node->data < x->data) {
             x = x->left;
+        } else if (unique && x->data == node->data) {
+            return false;
         } else {
             x = x->right;
         }
@@ -111,14 +140,44 @@ void RedBlackTree<T>::insert(const T& value) {
     node->right = NIL;
     node->isRed = true;
 
+    // Every ancestor gained the key; fixInsert's rotations keep it local
+    pullToRoot(node);
     fixInsert(node);
     nodeCount++;
-    updateLayout();
+    return true;
 }
 
-template<typename T>
-void RedBlackTree<T>::fixInsert(RBNode<T>* k) {
-    RBNode<T>* u;
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::merge(RedBlackTree& other) {
+    if (&other == this) return;
+
+    // Take other's nodes out as a bare binary tree and consume it in key
+    // order, rotating left children up so the walk needs no stack
+    RBNode<T, Augment>* n = other.root;
+    RBNode<T, Augment>* const otherNil = other.NIL;
+    other.root = otherNil;
+    other.nodeCount = 0;
+    otherNil->parent = nullptr;
+    while (n != otherNil) {
+        if (n->left != otherNil) {
+            RBNode<T, Augment>* l = n->left;
+            n->left = l->right;
+            l->right = n;
+            n = l;
+            continue;
+        }
+        RBNode<T, Augment>* next = n->right;
+        // Keys this tree already has stay behind in other, as with std::set
+        if (!attach(n, true)) {
+            other.attach(n);
+        }
+        n = next;
+    }
+}
+
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::fixInsert(RBNode<T, Augment>* k) {
+    RBNode<T, Augment>* u;
     while (k->parent != nullptr && k->parent->isRed) {
         if (k->parent == k->parent->parent->right) {
             u = k->parent->parent->left;
@@ -160,9 +219,9 @@ void RedBlackTree<T>::fixInsert(RBNode<T>* k) {
     root->isRed = false;
 }
 
-template<typename T>
-bool RedBlackTree<T>::search(const T& value) const {
-    RBNode<T>* current = root;
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::search(const T& value) const {
+    RBNode<T, Augment>* current = root;
     while (current != NIL) {
         if (value == current->data) {
             return true;
@@ -176,17 +235,16 @@ bool RedBlackTree<T>::search(const T& value) const {
     return false;
 }
 
-template<typename T>
-void RedBlackTree<T>::clearHelper(RBNode<T>* node) {
-    if (node != NIL) {
-        clearHelper(node->left);
-        clearHelper(node->right);
-        delete node;
-    }
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::clearHelper(RBNode<T, Augment>* node) {
+    struct Deleter : TraversalVisitor {
+        void post(RBNode<T, Augment>* n) { delete n; }
+    } deleter;
+    eulerTour(node, NIL, deleter);
 }
 
-template<typename T>
-void RedBlackTree<T>::clear() {
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::clear() {
     clearHelper(root);
     root = NIL;
     nodeCount = 0;
@@ -198,30 +256,23 @@ void RedBlackTree<T>::clear() {
     NIL->isRed = false;
 }
 
-template<typename T>
-void RedBlackTree<T>::inorderHelper(RBNode<T>* node, std::function<void(const T&)> visit) const {
-    if (node != NIL) {
-        inorderHelper(node->left, visit);
-        visit(node->data);
-        inorderHelper(node->right, visit);
-    }
-}
-
-template<typename T>
-void RedBlackTree<T>::inorder(std::function<void(const T&)> visit) const {
-    inorderHelper(root, visit);
+template<typename T, typename Augment>
+template<typename Visit>
+void RedBlackTree<T, Augment>::inorder(Visit&& visit) const {
+    auto onNode = [&visit](const RBNode<T, Augment>* n) { visit(n->data); };
+    inorderWalk<RBNode<T, Augment>>(root, NIL, onNode);
 }
 
-template<typename T>
-RBNode<T>* RedBlackTree<T>::minimum(RBNode<T>* node) const {
+template<typename T, typename Augment>
+RBNode<T, Augment>* RedBlackTree<T, Augment>::minimum(RBNode<T, Augment>* node) const {
     while (node->left != NIL) {
         node = node->left;
     }
     return node;
 }
 
-template<typename T>
-void RedBlackTree<T>::transplant(RBNode<T>* u, RBNode<T>* v) {
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::transplant(RBNode<T, Augment>* u, RBNode<T, Augment>* v) {
     if (u->parent == nullptr) {
         root = v;
     } else if (u == u->parent->left) {
@@ -232,9 +283,9 @@ void RedBlackTree<T>::transplant(RBNode<T>* u, RBNode<T>* v) {
     v->parent = u->parent;
 }
 
-template<typename T>
-bool RedBlackTree<T>::remove(const T& value) {
-    RBNode<T>* z = root;
+template<typename T, typename Augment>
+RBNode<T, Augment>* RedBlackTree<T, Augment>::find(const T& value) const {
+    RBNode<T, Augment>* z = root;
     while (z != NIL) {
         if (value == z->data) {
             break;
@@ -245,13 +296,34 @@ bool RedBlackTree<T>::remove(const T& value) {
             z = z->right;
         }
     }
-    
+    return z;
+}
+
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::remove(const T& value) {
+    RBNode<T, Augment>* z = find(value);
     if (z == NIL) {
         return false;
     }
+    detach(z);
+    delete z;
+    return true;
+}
+
+template<typename T, typename Augment>
+typename RedBlackTree<T, Augment>::NodeHandle RedBlackTree<T, Augment>::extract(const T& value) {
+    RBNode<T, Augment>* z = find(value);
+    if (z == NIL) {
+        return NodeHandle();
+    }
+    detach(z);
+    return NodeHandle(z);
+}
 
-    RBNode<T>* y = z;
-    RBNode<T>* x;
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::detach(RBNode<T, Augment>* z) {
+    RBNode<T, Augment>* y = z;
+    RBNode<T, Augment>* x;
     bool yOriginalColor = y->isRed;
 
     if (z->left == NIL) {
@@ -279,20 +351,22 @@ bool RedBlackTree<T>::remove(const T& value) {
         y->isRed = z->isRed;
     }
 
-    delete z;
+    // x->parent is the lowest relinked node (set even when x is NIL), and
+    // everything that changed, including a moved successor, is above it
+    pullToRoot(x->parent);
     nodeCount--;
 
     if (!yOriginalColor) {
         fixDelete(x);
     }
 
-    updateLayout();
-    return true;
+    // z is unlinked but still allocated; the caller frees or hands it out
+    z->left = z->right = z->parent = nullptr;
 }
 
-template<typename T>
-void RedBlackTree<T>::fixDelete(RBNode<T>* x) {
-    RBNode<T>* w;
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::fixDelete(RBNode<T, Augment>* x) {
+    RBNode<T, Augment>* w;
     while (x != root && !x->isRed) {
         if (x == x->parent->left) {
             w = x->parent->right;
@@ -347,107 +421,400 @@ void RedBlackTree<T>::fixDelete(RBNode<T>* x) {
     x->isRed = false;
 }
 
-template<typename T>
-int RedBlackTree<T>::height() const {
+template<typename T, typename Augment>
+int RedBlackTree<T, Augment>::height() const {
     return heightHelper(root);
 }
 
-template<typename T>
-int RedBlackTree<T>::heightHelper(RBNode<T>* node) const {
-    if (node == NIL) return 0;
-    return 1 + std::max(heightHelper(node->left), heightHelper(node->right));
+template<typename T, typename Augment>
+int RedBlackTree<T, Augment>::heightHelper(RBNode<T, Augment>* node) const {
+    struct Depth : TraversalVisitor {
+        int depth = 0;
+        int best = 0;
+        void pre(RBNode<T, Augment>*) { best = std::max(best, ++depth); }
+        void post(RBNode<T, Augment>*) { --depth; }
+    } depth;
+    eulerTour(node, NIL, depth);
+    return depth.best;
 }
 
-template<typename T>
-std::vector<RBNode<T>*> RedBlackTree<T>::getAllNodes() const {
-    std::vector<RBNode<T>*> nodes;
+template<typename T, typename Augment>
+std::vector<RBNode<T, Augment>*> RedBlackTree<T, Augment>::getAllNodes() const {
+    std::vector<RBNode<T, Augment>*> nodes;
+    nodes.reserve(nodeCount);
     collectNodes(root, nodes);
     return nodes;
 }
 
-template<typename T>
-void RedBlackTree<T>::collectNodes(RBNode<T>* node, std::vector<RBNode<T>*>& nodes) const {
-    if (node != NIL) {
-        nodes.push_back(node);
-        collectNodes(node->left, nodes);
-        collectNodes(node->right, nodes);
-    }
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::collectNodes(RBNode<T, Augment>* node, std::vector<RBNode<T, Augment>*>& nodes) const {
+    // Preorder, matching the order the frontend has always received.
+    struct Collector : TraversalVisitor {
+        std::vector<RBNode<T, Augment>*>& out;
+        explicit Collector(std::vector<RBNode<T, Augment>*>& o) : out(o) {}
+        void pre(RBNode<T, Augment>* n) { out.push_back(n); }
+    } collector(nodes);
+    eulerTour(node, NIL, collector);
 }
 
-template<typename T>
-void RedBlackTree<T>::updateLayout() {
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::updateLayout() {
     if (root == NIL) return;
     
     int position = 0;
     calculatePositions(root, 0, position);
 }
 
-template<typename T>
-void RedBlackTree<T>::calculatePositions(RBNode<T>* node, int level, int& position) {
-    if (node == NIL) return;
-    
-    calculatePositions(node->left, level + 1, position);
-    
-    node->x = position * 80; // 80px spacing between nodes
-    node->y = level * 100;   // 100px spacing between levels
-    node->level = level;
-    position++;
-    
-    calculatePositions(node->right, level + 1, position);
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::calculatePositions(RBNode<T, Augment>* node, int level, int& position) {
+    struct Layout : TraversalVisitor {
+        int level;
+        int& position;
+        Layout(int l, int& p) : level(l - 1), position(p) {}
+        void pre(RBNode<T, Augment>*) { ++level; }
+        void in(RBNode<T, Augment>* n) {
+            n->x = position * 80; // 80px spacing between nodes
+            n->y = level * 100;   // 100px spacing between levels
+            n->level = level;
+            position++;
+        }
+        void post(RBNode<T, Augment>*) { --level; }
+    } layout(level, position);
+    eulerTour(node, NIL, layout);
 }
 
-template<typename T>
-std::string RedBlackTree<T>::toJSON() const {
+template<typename T, typename Augment>
+std::string RedBlackTree<T, Augment>::toJSON() const {
     if (root == NIL) return "null";
-    return nodeToJSON(root);
+    std::ostringstream oss;
+    nodeToJSON(root, oss);
+    return oss.str();
 }
 
-template<typename T>
-std::string RedBlackTree<T>::nodeToJSON(RBNode<T>* node) const {
-    if (node == NIL) return "null";
-    
-    std::ostringstream oss;
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::nodeToJSON(RBNode<T, Augment>* node, std::ostream& out) const {
+    // Everything before "left" is written on the way down, the separator
+    // between the children on the way through, and the closing brace on the
+    // way back up, so the whole document streams into one buffer.
+    struct Writer : TraversalVisitor {
+        std::ostream& oss;
+        explicit Writer(std::ostream& o) : oss(o) {}
+        void pre(RBNode<T, Augment>* n) { writeNodeOpen(n, oss); }
+        void in(RBNode<T, Augment>*) { oss << ",\"right\":"; }
+        void post(RBNode<T, Augment>*) { oss << "}"; }
+        void nil() { oss << "null"; }
+    } writer(out);
+    eulerTour(node, NIL, writer);
+}
+
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::writeNodeOpen(const RBNode<T, Augment>* node, std::ostream& oss) {
     oss << "{";
-    oss << "\"data\":" << node->data << ",";
+    oss << "\"data\":";
+    writeJsonKey(oss, node->data);
+    oss << ",";
     oss << "\"color\":\"" << (node->isRed ? "red" : "black") << "\",";
     oss << "\"x\":" << node->x << ",";
     oss << "\"y\":" << node->y << ",";
-    oss << "\"left\":" << nodeToJSON(node->left) << ",";
-    oss << "\"right\":" << nodeToJSON(node->right);
-    oss << "}";
-    return oss.str();
+    oss << "\"left\":";
 }
 
-template<typename T>
-bool RedBlackTree<T>::isValidRBTree() const {
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::isValidRBTree() const {
     if (root == NIL) return true;
     if (root->isRed) return false; // Root must be black
     
     int blackHeight = -1;
-    return validateNode(root, 0, blackHeight);
+    return validateNode(root, 0, blackHeight) && validateSummaries(root);
 }
 
-template<typename T>
-bool RedBlackTree<T>::validateNode(RBNode<T>* node, int blackCount, int& blackHeight) const {
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::validateNode(RBNode<T, Augment>* node, int blackCount, int& blackHeight) const {
+    struct Validator : TraversalVisitor {
+        const RBNode<T, Augment>* NIL;
+        int blackCount;
+        int& blackHeight;
+        bool valid = true;
+        Validator(const RBNode<T, Augment>* nil, int count, int& height)
+            : NIL(nil), blackCount(count), blackHeight(height) {}
+        void pre(RBNode<T, Augment>* n) {
+            // Red node cannot have red children
+            if (n->isRed &&
+                ((n->left != NIL && n->left->isRed) ||
+                 (n->right != NIL && n->right->isRed))) {
+                valid = false;
+            }
+            if (!n->isRed) blackCount++;
+        }
+        void post(RBNode<T, Augment>* n) {
+            if (!n->isRed) blackCount--;
+        }
+        void nil() {
+            if (blackHeight == -1) {
+                blackHeight = blackCount;
+            }
+            if (blackHeight != blackCount) valid = false;
+        }
+    } validator(NIL, blackCount, blackHeight);
+    eulerTour(node, NIL, validator);
+    return validator.valid;
+}
+
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::pull(RBNode<T, Augment>* node) {
+    if constexpr (Augment::enabled) {
+        node->summary = Augment::combine(
+            Augment::combine(node->left->summary, Augment::fromKey(node->data)),
+            node->right->summary);
+    } else {
+        (void)node;
+    }
+}
+
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::pullToRoot(RBNode<T, Augment>* node) {
+    if constexpr (Augment::enabled) {
+        for (; node != nullptr && node != NIL; node = node->parent) {
+            pull(node);
+        }
+    } else {
+        (void)node;
+    }
+}
+
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::summaryHolds(const RBNode<T, Augment>* node) const {
+    if constexpr (Augment::enabled) {
+        return node->summary == Augment::combine(
+            Augment::combine(node->left->summary, Augment::fromKey(node->data)),
+            node->right->summary);
+    } else {
+        (void)node;
+        return true;
+    }
+}
+
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::validateSummaries(RBNode<T, Augment>* node) const {
+    if constexpr (Augment::enabled) {
+        // Children are checked before their parent, so a bad summary is
+        // reported where it is first wrong
+        struct Checker : TraversalVisitor {
+            const RedBlackTree* tree;
+            bool valid = true;
+            explicit Checker(const RedBlackTree* t) : tree(t) {}
+            void post(RBNode<T, Augment>* n) {
+                if (valid && !tree->summaryHolds(n)) valid = false;
+            }
+        } checker(this);
+        if (!(NIL->summary == Augment::identity())) return false;
+        eulerTour(node, NIL, checker);
+        return checker.valid;
+    } else {
+        (void)node;
+        return true;
+    }
+}
+
+template<typename T, typename Augment>
+typename Augment::value_type RedBlackTree<T, Augment>::aggregate(const T* from, const T* to) const {
+    static_assert(Augment::enabled, "aggregate() needs an augmentation policy");
+    using A = Augment;
+
+    // The first node inside the range splits it: everything in [from, to]
+    // is in its subtree, left of it or right of it
+    const RBNode<T, Augment>* split = root;
+    while (split != NIL) {
+        if (from && split->data < *from) {
+            split = split->right;
+        } else if (to && *to < split->data) {
+            split = split->left;
+        } else {
+            break;
+        }
+    }
+    if (split == NIL) return A::identity();
+
+    // Down the left boundary, a node at or above `from` is in range along
+    // with its whole right subtree, and precedes what was collected so far
+    typename A::value_type left = A::identity();
+    for (const RBNode<T, Augment>* n = split->left; n != NIL;) {
+        if (from && n->data < *from) {
+            n = n->right;
+        } else {
+            left = A::combine(A::combine(A::fromKey(n->data), n->right->summary), left);
+            n = n->left;
+        }
+    }
+
+    typename A::value_type right = A::identity();
+    for (const RBNode<T, Augment>* n = split->right; n != NIL;) {
+        if (to && *to < n->data) {
+            n = n->left;
+        } else {
+            right = A::combine(right, A::combine(n->left->summary, A::fromKey(n->data)));
+            n = n->right;
+        }
+    }
+
+    return A::combine(A::combine(left, A::fromKey(split->data)), right);
+}
+
+template<typename T, typename Augment>
+std::vector<typename RedBlackTree<T, Augment>::FrontierStep>
+RedBlackTree<T, Augment>::planFrontier(int cutoffDepth) const {
+    std::vector<FrontierStep> steps;
+    planFrontier(root, 1, 0, cutoffDepth, steps);
+    return steps;
+}
+
+template<typename T, typename Augment>
+void RedBlackTree<T, Augment>::planFrontier(RBNode<T, Augment>* node, int depth, int blackCount, int cutoffDepth,
+                                   std::vector<FrontierStep>& steps) const {
+    // Recursion is bounded by cutoffDepth, not by the tree.
     if (node == NIL) {
-        if (blackHeight == -1) {
-            blackHeight = blackCount;
+        steps.push_back({FrontierStep::Nil, node, depth, blackCount});
+        return;
+    }
+    if (depth > cutoffDepth) {
+        steps.push_back({FrontierStep::Subtree, node, depth, blackCount});
+        return;
+    }
+    steps.push_back({FrontierStep::Pre, node, depth, blackCount});
+    const int below = blackCount + (node->isRed ? 0 : 1);
+    planFrontier(node->left, depth + 1, below, cutoffDepth, steps);
+    steps.push_back({FrontierStep::In, node, depth, blackCount});
+    planFrontier(node->right, depth + 1, below, cutoffDepth, steps);
+    steps.push_back({FrontierStep::Post, node, depth, blackCount});
+}
+
+template<typename T, typename Augment>
+template<typename Work>
+void RedBlackTree<T, Augment>::forEachSubtree(WorkStealingPool& pool, const std::vector<FrontierStep>& steps,
+                                     Work&& work) const {
+    TaskGroup group(pool);
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (steps[i].kind == FrontierStep::Subtree) {
+            group.run([&work, &steps, i] { work(i, steps[i]); });
         }
-        return blackHeight == blackCount;
     }
-    
-    // Red node cannot have red children
-    if (node->isRed) {
-        if ((node->left != NIL && node->left->isRed) || 
-            (node->right != NIL && node->right->isRed)) {
-            return false;
+    group.wait();
+}
+
+template<typename T, typename Augment>
+int RedBlackTree<T, Augment>::height(WorkStealingPool& pool, int cutoffDepth) const {
+    auto steps = planFrontier(cutoffDepth);
+    std::vector<int> heights(steps.size(), 0);
+    forEachSubtree(pool, steps, [this, &heights](size_t i, const FrontierStep& step) {
+        heights[i] = step.depth - 1 + heightHelper(step.node);
+    });
+
+    int result = 0;
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (steps[i].kind == FrontierStep::Pre) {
+            result = std::max(result, steps[i].depth);
+        } else if (steps[i].kind == FrontierStep::Subtree) {
+            result = std::max(result, heights[i]);
         }
     }
-    
-    if (!node->isRed) blackCount++;
-    
-    return validateNode(node->left, blackCount, blackHeight) && 
-           validateNode(node->right, blackCount, blackHeight);
+    return result;
+}
+
+template<typename T, typename Augment>
+bool RedBlackTree<T, Augment>::isValidRBTree(WorkStealingPool& pool, int cutoffDepth) const {
+    if (root == NIL) return true;
+    if (root->isRed) return false; // Root must be black
+
+    auto steps = planFrontier(cutoffDepth);
+    std::vector<int> blackHeights(steps.size(), -1);
+    std::vector<char> valid(steps.size(), 1);
+    forEachSubtree(pool, steps, [this, &blackHeights, &valid](size_t i, const FrontierStep& step) {
+        valid[i] = validateNode(step.node, step.blackCount, blackHeights[i]) &&
+                   validateSummaries(step.node);
+    });
+
+    // Same checks as validateNode(), applied to the unrolled top levels, and
+    // every leaf position (in a subtree or not) must agree on black height.
+    int blackHeight = -1;
+    for (size_t i = 0; i < steps.size(); i++) {
+        const FrontierStep& step = steps[i];
+        int leafHeight = -1;
+        if (step.kind == FrontierStep::Pre) {
+            RBNode<T, Augment>* n = step.node;
+            if (n->isRed &&
+                ((n->left != NIL && n->left->isRed) ||
+                 (n->right != NIL && n->right->isRed))) {
+                return false;
+            }
+            if (!summaryHolds(n)) return false;
+        } else if (step.kind == FrontierStep::Nil) {
+            leafHeight = step.blackCount;
+        } else if (step.kind == FrontierStep::Subtree) {
+            if (!valid[i]) return false;
+            leafHeight = blackHeights[i];
+        }
+        if (leafHeight != -1) {
+            if (blackHeight == -1) blackHeight = leafHeight;
+            if (blackHeight != leafHeight) return false;
+        }
+    }
+    return true;
+}
+
+template<typename T, typename Augment>
+std::vector<RBNode<T, Augment>*> RedBlackTree<T, Augment>::getAllNodes(WorkStealingPool& pool, int cutoffDepth) const {
+    auto steps = planFrontier(cutoffDepth);
+    std::vector<std::vector<RBNode<T, Augment>*>> parts(steps.size());
+    forEachSubtree(pool, steps, [this, &parts](size_t i, const FrontierStep& step) {
+        collectNodes(step.node, parts[i]);
+    });
+
+    // Preorder: an unrolled node comes before everything beneath it.
+    std::vector<RBNode<T, Augment>*> nodes;
+    nodes.reserve(nodeCount);
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (steps[i].kind == FrontierStep::Pre) {
+            nodes.push_back(steps[i].node);
+        } else if (steps[i].kind == FrontierStep::Subtree) {
+            nodes.insert(nodes.end(), parts[i].begin(), parts[i].end());
+        }
+    }
+    return nodes;
+}
+
+template<typename T, typename Augment>
+std::string RedBlackTree<T, Augment>::toJSON(WorkStealingPool& pool, int cutoffDepth) const {
+    if (root == NIL) return "null";
+
+    auto steps = planFrontier(cutoffDepth);
+    std::vector<std::string> fragments(steps.size());
+    forEachSubtree(pool, steps, [this, &fragments](size_t i, const FrontierStep& step) {
+        std::ostringstream oss;
+        nodeToJSON(step.node, oss);
+        fragments[i] = oss.str();
+    });
+
+    // The unrolled levels emit exactly what the Writer visitor would.
+    size_t total = 0;
+    for (size_t i = 0; i < steps.size(); i++) {
+        std::ostringstream oss;
+        switch (steps[i].kind) {
+            case FrontierStep::Pre: writeNodeOpen(steps[i].node, oss); break;
+            case FrontierStep::In: oss << ",\"right\":"; break;
+            case FrontierStep::Post: oss << "}"; break;
+            case FrontierStep::Nil: oss << "null"; break;
+            case FrontierStep::Subtree: break;
+        }
+        if (steps[i].kind != FrontierStep::Subtree) fragments[i] = oss.str();
+        total += fragments[i].size();
+    }
+
+    std::string json;
+    json.reserve(total);
+    for (const auto& fragment : fragments) {
+        json += fragment;
+    }
+    return json;
 }
 
 } // namespace rbtree
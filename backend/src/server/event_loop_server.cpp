@@ -0,0 +1,694 @@
+#include "event_loop_server.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t kMaxHeaderBytes = 8192;
+const size_t kReadChunk = 16384;
+// Stop parsing pipelined requests while this much output is unsent
+const size_t kMaxPendingOutput = 1 << 20;
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 409: return "Conflict";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+bool equalsIgnoreCase(const std::string& a, const char* b) {
+    size_t n = std::strlen(b);
+    if (a.size() != n) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+std::string decodeUrl(const std::string& s, bool plusAsSpace) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '%' && i + 2 < s.size() &&
+            std::isxdigit(static_cast<unsigned char>(s[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(s[i + 2]))) {
+            out += static_cast<char>(std::stoi(s.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else if (plusAsSpace && s[i] == '+') {
+            out += ' ';
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+void parseQuery(const std::string& query, httplib::Params& params) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t amp = query.find('&', pos);
+        if (amp == std::string::npos) amp = query.size();
+        std::string pair = query.substr(pos, amp - pos);
+        if (!pair.empty()) {
+            size_t eq = pair.find('=');
+            std::string key = decodeUrl(pair.substr(0, eq), true);
+            std::string value = eq == std::string::npos ? "" : decodeUrl(pair.substr(eq + 1), true);
+            params.emplace(key, value);
+        }
+        pos = amp + 1;
+    }
+}
+
+} // namespace
+
+struct EventLoopServer::Connection {
+    int fd = -1;
+    std::string in;
+    std::string out;
+    size_t outOffset = 0;
+    size_t served = 0;
+    bool closeAfterWrite = false;
+    bool wantWrite = false;
+    std::chrono::steady_clock::time_point lastActive;
+    std::string remoteAddr;
+    int remotePort = -1;
+    // A deferred request; later ones wait in `in` until it is answered
+    std::unique_ptr<Parked> parked;
+};
+
+struct EventLoopServer::Parked {
+    httplib::Request req;
+    bool keepAlive = true;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+struct EventLoopServer::Deferral {
+    bool rerun = false;    // the request was parked before
+    bool expired = false;  // and its deadline has passed
+    bool deferred = false;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+thread_local EventLoopServer::Deferral* EventLoopServer::currentDeferral_ = nullptr;
+
+EventLoopServer::~EventLoopServer() {
+    stop();
+}
+
+EventLoopServer& EventLoopServer::addRoute(const char* method, const std::string& pattern, Handler handler) {
+    routes_.push_back({method, std::regex(pattern), std::move(handler)});
+    return *this;
+}
+
+EventLoopServer& EventLoopServer::Get(const std::string& pattern, Handler handler) {
+    return addRoute("GET", pattern, std::move(handler));
+}
+
+EventLoopServer& EventLoopServer::Post(const std::string& pattern, Handler handler) {
+    return addRoute("POST", pattern, std::move(handler));
+}
+
+EventLoopServer& EventLoopServer::Put(const std::string& pattern, Handler handler) {
+    return addRoute("PUT", pattern, std::move(handler));
+}
+
+EventLoopServer& EventLoopServer::Delete(const std::string& pattern, Handler handler) {
+    return addRoute("DELETE", pattern, std::move(handler));
+}
+
+EventLoopServer& EventLoopServer::Options(const std::string& pattern, Handler handler) {
+    return addRoute("OPTIONS", pattern, std::move(handler));
+}
+
+EventLoopServer& EventLoopServer::set_pre_routing_handler(HandlerWithResponse handler) {
+    preRouting_ = std::move(handler);
+    return *this;
+}
+
+EventLoopServer& EventLoopServer::set_event_loops(size_t count) {
+    eventLoops_ = count;
+    return *this;
+}
+
+EventLoopServer& EventLoopServer::set_keep_alive_max_count(size_t count) {
+    keepAliveMaxCount_ = count;
+    return *this;
+}
+
+EventLoopServer& EventLoopServer::set_keep_alive_timeout(time_t sec) {
+    keepAliveTimeout_ = std::chrono::seconds(sec);
+    return *this;
+}
+
+EventLoopServer& EventLoopServer::set_read_timeout(time_t sec, time_t usec) {
+    readTimeout_ = std::chrono::seconds(sec) + std::chrono::microseconds(usec);
+    return *this;
+}
+
+EventLoopServer& EventLoopServer::set_write_timeout(time_t sec, time_t usec) {
+    writeTimeout_ = std::chrono::seconds(sec) + std::chrono::microseconds(usec);
+    return *this;
+}
+
+EventLoopServer& EventLoopServer::set_payload_max_length(size_t length) {
+    payloadMaxLength_ = length;
+    return *this;
+}
+
+void EventLoopServer::dispatch(httplib::Request& req, httplib::Response& res) {
+    res.version = "HTTP/1.1";
+    try {
+        if (preRouting_ && preRouting_(req, res) == HandlerResponse::Handled) {
+            if (res.status == -1) res.status = 200;
+            return;
+        }
+        for (const auto& route : routes_) {
+            if (route.method == req.method && std::regex_match(req.path, req.matches, route.pattern)) {
+                route.handler(req, res);
+                if (res.status == -1) res.status = 200;
+                return;
+            }
+        }
+        res.status = 404;
+    } catch (const std::exception& e) {
+        std::cerr << "Handler error: " << e.what() << std::endl;
+        res.status = 500;
+    }
+}
+
+bool EventLoopServer::defer(std::chrono::milliseconds timeout) {
+    Deferral* deferral = currentDeferral_;
+    if (!deferral || deferral->expired) return false;
+    if (!deferral->rerun) deferral->deadline = std::chrono::steady_clock::now() + timeout;
+    deferral->deferred = true;
+    return true;
+}
+
+bool EventLoopServer::deferred() {
+    return currentDeferral_ && currentDeferral_->deferred;
+}
+
+void EventLoopServer::respond(Connection& conn, httplib::Request& req, bool keepAlive, Deferral& deferral) {
+    httplib::Response res;
+    currentDeferral_ = &deferral;
+    dispatch(req, res);
+    currentDeferral_ = nullptr;
+    if (deferral.deferred) {
+        if (!deferral.rerun) parked_++;
+        conn.parked.reset(new Parked{std::move(req), keepAlive, deferral.deadline});
+        return;
+    }
+    if (deferral.rerun) parked_--;
+    writeResponse(conn, res, keepAlive);
+    if (!keepAlive) conn.closeAfterWrite = true;
+}
+
+void EventLoopServer::writeResponse(Connection& conn, const httplib::Response& res, bool keepAlive) {
+    std::string& out = conn.out;
+    out += "HTTP/1.1 ";
+    out += std::to_string(res.status);
+    out += ' ';
+    out += reasonPhrase(res.status);
+    out += "\r\n";
+    for (const auto& header : res.headers) {
+        if (equalsIgnoreCase(header.first, "Content-Length") ||
+            equalsIgnoreCase(header.first, "Connection")) {
+            continue;
+        }
+        out += header.first;
+        out += ": ";
+        out += header.second;
+        out += "\r\n";
+    }
+    out += "Content-Length: ";
+    out += std::to_string(res.body.size());
+    out += keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+    out += res.body;
+}
+
+void EventLoopServer::writeError(Connection& conn, int status) {
+    httplib::Response res;
+    res.status = status;
+    // Errors raised before routing still need the CORS headers
+    if (preRouting_) {
+        httplib::Request req;
+        preRouting_(req, res);
+    }
+    writeResponse(conn, res, false);
+    conn.closeAfterWrite = true;
+}
+
+void EventLoopServer::processRequests(Connection& conn) {
+    size_t consumed = 0;
+    while (!conn.closeAfterWrite && !conn.parked && conn.out.size() - conn.outOffset < kMaxPendingOutput) {
+        const size_t headerEnd = conn.in.find("\r\n\r\n", consumed);
+        if (headerEnd == std::string::npos) {
+            if (conn.in.size() - consumed > kMaxHeaderBytes) writeError(conn, 431);
+            break;
+        }
+        if (headerEnd - consumed > kMaxHeaderBytes) {
+            writeError(conn, 431);
+            break;
+        }
+
+        httplib::Request req;
+        req.remote_addr = conn.remoteAddr;
+        req.remote_port = conn.remotePort;
+
+        // Request line
+        size_t lineEnd = conn.in.find("\r\n", consumed);
+        std::string requestLine = conn.in.substr(consumed, lineEnd - consumed);
+        size_t sp1 = requestLine.find(' ');
+        size_t sp2 = sp1 == std::string::npos ? std::string::npos : requestLine.find(' ', sp1 + 1);
+        if (sp2 == std::string::npos) {
+            writeError(conn, 400);
+            break;
+        }
+        req.method = requestLine.substr(0, sp1);
+        req.target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+        req.version = requestLine.substr(sp2 + 1);
+        size_t question = req.target.find('?');
+        req.path = decodeUrl(req.target.substr(0, question), false);
+        if (question != std::string::npos) {
+            parseQuery(req.target.substr(question + 1), req.params);
+        }
+
+        // Headers
+        size_t pos = lineEnd + 2;
+        while (pos < headerEnd) {
+            size_t end = conn.in.find("\r\n", pos);
+            std::string line = conn.in.substr(pos, end - pos);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                req.headers.emplace(trim(line.substr(0, colon)), trim(line.substr(colon + 1)));
+            }
+            pos = end + 2;
+        }
+
+        // Chunked request bodies are not supported; clients send Content-Length
+        const std::string encoding = req.get_header_value("Transfer-Encoding");
+        if (!encoding.empty() && !equalsIgnoreCase(encoding, "identity")) {
+            writeError(conn, 411);
+            break;
+        }
+        size_t contentLength = 0;
+        const std::string lengthHeader = req.get_header_value("Content-Length");
+        if (!lengthHeader.empty()) {
+            try {
+                contentLength = std::stoull(lengthHeader);
+            } catch (const std::exception&) {
+                writeError(conn, 400);
+                break;
+            }
+        }
+        if (contentLength > payloadMaxLength_) {
+            writeError(conn, 413);
+            break;
+        }
+        const size_t bodyStart = headerEnd + 4;
+        if (conn.in.size() - bodyStart < contentLength) {
+            break; // Wait for the rest of the body
+        }
+        req.body = conn.in.substr(bodyStart, contentLength);
+        consumed = bodyStart + contentLength;
+
+        const std::string connection = req.get_header_value("Connection");
+        bool keepAlive = req.version == "HTTP/1.1" ? !equalsIgnoreCase(connection, "close")
+                                                   : equalsIgnoreCase(connection, "keep-alive");
+        conn.served++;
+        if (keepAliveMaxCount_ > 0 && conn.served >= keepAliveMaxCount_) keepAlive = false;
+
+        Deferral deferral;
+        respond(conn, req, keepAlive, deferral);
+    }
+    conn.in.erase(0, consumed);
+}
+
+#ifdef __linux__
+
+bool EventLoopServer::readFrom(Connection& conn) {
+    char buffer[kReadChunk];
+    while (true) {
+        ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.in.append(buffer, static_cast<size_t>(n));
+            if (conn.in.size() > payloadMaxLength_ + kMaxHeaderBytes + kReadChunk) break;
+            continue;
+        }
+        if (n == 0) return false; // Peer closed
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+        return false;
+    }
+    return true;
+}
+
+bool EventLoopServer::flush(Connection& conn) {
+    while (conn.outOffset < conn.out.size()) {
+        ssize_t n = ::send(conn.fd, conn.out.data() + conn.outOffset,
+                           conn.out.size() - conn.outOffset, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.outOffset += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+    conn.out.clear();
+    conn.outOffset = 0;
+    return !conn.closeAfterWrite;
+}
+
+void EventLoopServer::runLoop(int listenFd, int wakeFd) {
+    int epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        std::cerr << "epoll_create1 failed: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.fd = wakeFd;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    std::unordered_map<int, Connection> connections;
+    // Connections holding a deferred request, and the earliest deadline
+    std::unordered_set<int> parkedFds;
+    auto nextDeadline = std::chrono::steady_clock::time_point::max();
+    bool resumeParked = false;
+    auto closeConnection = [&](int fd) {
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        auto it = connections.find(fd);
+        if (it != connections.end() && it->second.parked) parked_--;
+        parkedFds.erase(fd);
+        connections.erase(fd);
+    };
+    auto trackParked = [&](Connection& conn) {
+        if (!conn.parked || !parkedFds.insert(conn.fd).second) return;
+        nextDeadline = std::min(nextDeadline, conn.parked->deadline);
+        // Run it once more straight away: a resume_deferred() between the
+        // handler's check and parked_ counting it sent no wakeup
+        resumeParked = true;
+    };
+    auto updateInterest = [&](Connection& conn) {
+        const bool wantWrite = conn.outOffset < conn.out.size();
+        if (wantWrite == conn.wantWrite) return;
+        epoll_event mod{};
+        mod.events = EPOLLIN | EPOLLRDHUP;
+        if (wantWrite) mod.events |= EPOLLOUT;
+        mod.data.fd = conn.fd;
+        ::epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &mod);
+        conn.wantWrite = wantWrite;
+    };
+
+    const int kMaxEvents = 256;
+    epoll_event events[kMaxEvents];
+    auto lastSweep = std::chrono::steady_clock::now();
+    // Often enough that sub-second timeouts are honoured too
+    const auto sweepEvery = std::max<std::chrono::microseconds>(
+        std::chrono::milliseconds(1),
+        std::min<std::chrono::microseconds>({std::chrono::seconds(1), keepAliveTimeout_, readTimeout_, writeTimeout_}));
+    const int sweepMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(sweepEvery).count());
+
+    while (running_) {
+        int timeoutMs = sweepMs;
+        if (resumeParked) {
+            timeoutMs = 0;
+        } else if (!parkedFds.empty()) {
+            const auto untilDeadline = std::chrono::duration_cast<std::chrono::milliseconds>(
+                nextDeadline - std::chrono::steady_clock::now()).count() + 1;
+            timeoutMs = static_cast<int>(std::max<long long>(0, std::min<long long>(timeoutMs, untilDeadline)));
+        }
+        int n = ::epoll_wait(epollFd, events, kMaxEvents, timeoutMs);
+        if (n < 0 && errno != EINTR) break;
+        const auto now = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < n; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                uint64_t value;
+                ssize_t ignored = ::read(wakeFd, &value, sizeof(value));
+                (void)ignored;
+                resumeParked = true;
+                continue;
+            }
+            if (fd == listenFd) {
+                while (true) {
+                    sockaddr_storage addr{};
+                    socklen_t len = sizeof(addr);
+                    int client = ::accept4(listenFd, reinterpret_cast<sockaddr*>(&addr), &len,
+                                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (client < 0) break;
+                    int one = 1;
+                    ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+                    Connection& conn = connections[client];
+                    conn.fd = client;
+                    conn.lastActive = now;
+                    char host[NI_MAXHOST], port[NI_MAXSERV];
+                    if (::getnameinfo(reinterpret_cast<sockaddr*>(&addr), len, host, sizeof(host),
+                                      port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+                        conn.remoteAddr = host;
+                        conn.remotePort = std::atoi(port);
+                    }
+
+                    epoll_event add{};
+                    add.events = EPOLLIN | EPOLLRDHUP;
+                    add.data.fd = client;
+                    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &add);
+                }
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            Connection& conn = it->second;
+            conn.lastActive = now;
+
+            if (events[i].events & EPOLLERR) {
+                closeConnection(fd);
+                continue;
+            }
+            bool open = true;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                const bool peerOpen = readFrom(conn);
+                processRequests(conn);
+                // A half-closed peer still gets answers to what it sent
+                if (!peerOpen) conn.closeAfterWrite = true;
+            }
+            if (events[i].events & EPOLLOUT || conn.outOffset < conn.out.size() || conn.closeAfterWrite) {
+                open = flush(conn);
+                if (open && conn.out.empty() && !conn.in.empty()) {
+                    // Output drained; resume pipelined requests held back
+                    processRequests(conn);
+                    open = flush(conn);
+                }
+            }
+            if (!open) {
+                closeConnection(fd);
+                continue;
+            }
+            trackParked(conn);
+            updateInterest(conn);
+        }
+
+        // Deferred requests run again on a wakeup and once past their deadline
+        if (resumeParked || (!parkedFds.empty() && now >= nextDeadline)) {
+            resumeParked = false;
+            nextDeadline = std::chrono::steady_clock::time_point::max();
+            const std::vector<int> waiting(parkedFds.begin(), parkedFds.end());
+            for (int fd : waiting) {
+                Connection& conn = connections[fd];
+                std::unique_ptr<Parked> parked = std::move(conn.parked);
+                Deferral deferral;
+                deferral.rerun = true;
+                deferral.deadline = parked->deadline;
+                deferral.expired = now >= parked->deadline;
+                respond(conn, parked->req, parked->keepAlive, deferral);
+                if (conn.parked) {
+                    nextDeadline = std::min(nextDeadline, conn.parked->deadline);
+                    continue;
+                }
+                parkedFds.erase(fd);
+                // Answered; pipelined requests held behind it go next
+                processRequests(conn);
+                if (!flush(conn)) {
+                    closeConnection(fd);
+                    continue;
+                }
+                trackParked(conn);
+                updateInterest(conn);
+            }
+        }
+
+        // Idle keep-alive, slow request and stalled write timeouts
+        if (now - lastSweep >= sweepEvery) {
+            lastSweep = now;
+            std::vector<int> expired;
+            for (auto& entry : connections) {
+                const Connection& conn = entry.second;
+                if (conn.parked) continue;  // bounded by its own deadline
+                std::chrono::microseconds limit = keepAliveTimeout_;
+                if (conn.outOffset < conn.out.size()) {
+                    limit = writeTimeout_;
+                } else if (!conn.in.empty()) {
+                    limit = readTimeout_;
+                }
+                if (now - conn.lastActive >= limit) {
+                    expired.push_back(entry.first);
+                }
+            }
+            for (int fd : expired) closeConnection(fd);
+        }
+    }
+
+    for (auto& entry : connections) {
+        if (entry.second.parked) parked_--;
+        ::close(entry.first);
+    }
+    ::close(epollFd);
+}
+
+bool EventLoopServer::listen(const std::string& host, int port) {
+    size_t loops = eventLoops_;
+    if (loops == 0) loops = std::max(1u, std::thread::hardware_concurrency());
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* result = nullptr;
+    const std::string service = std::to_string(port);
+    if (::getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0 || !result) {
+        std::cerr << "Cannot resolve " << host << std::endl;
+        return false;
+    }
+
+    // One listener per loop; the kernel spreads new connections across them
+    std::vector<int> listenFds;
+    for (size_t i = 0; i < loops; i++) {
+        int fd = ::socket(result->ai_family, result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          result->ai_protocol);
+        int one = 1;
+        bool ok = fd >= 0 &&
+                  ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+                  ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0 &&
+                  ::bind(fd, result->ai_addr, result->ai_addrlen) == 0 &&
+                  ::listen(fd, SOMAXCONN) == 0;
+        if (!ok) {
+            std::cerr << "Cannot listen on " << host << ":" << port << ": "
+                      << std::strerror(errno) << std::endl;
+            if (fd >= 0) ::close(fd);
+            for (int open : listenFds) ::close(open);
+            ::freeaddrinfo(result);
+            return false;
+        }
+        listenFds.push_back(fd);
+    }
+    ::freeaddrinfo(result);
+
+    wakeFds_.clear();
+    for (size_t i = 0; i < loops; i++) {
+        wakeFds_.push_back(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    }
+
+    running_ = true;
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < loops; i++) {
+        threads.emplace_back([this, &listenFds, i] { runLoop(listenFds[i], wakeFds_[i]); });
+    }
+    runLoop(listenFds[0], wakeFds_[0]);
+    running_ = false;
+    for (size_t i = 1; i < loops; i++) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFds_[i], &one, sizeof(one));
+        (void)ignored;
+    }
+    for (auto& t : threads) t.join();
+
+    for (int fd : listenFds) ::close(fd);
+    for (int fd : wakeFds_) ::close(fd);
+    wakeFds_.clear();
+    return true;
+}
+
+void EventLoopServer::resume_deferred() {
+    if (parked_.load() == 0) return;
+    for (int fd : wakeFds_) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void EventLoopServer::stop() {
+    if (!running_.exchange(false)) return;
+    for (int fd : wakeFds_) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+#else
+
+bool EventLoopServer::readFrom(Connection&) { return false; }
+bool EventLoopServer::flush(Connection&) { return false; }
+void EventLoopServer::runLoop(int, int) {}
+
+bool EventLoopServer::listen(const std::string&, int) {
+    std::cerr << "The epoll front end is only available on Linux" << std::endl;
+    return false;
+}
+
+void EventLoopServer::resume_deferred() {}
+void EventLoopServer::stop() {}
+
+#endif
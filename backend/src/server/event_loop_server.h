@@ -0,0 +1,104 @@
+#pragma once
+#include "httplib.h"
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <regex>
+#include <string>
+#include <vector>
+
+// epoll-driven HTTP/1.1 front end.
+//
+// Idle keep-alive connections cost a file descriptor and a small buffer
+// instead of a pool thread, so thousands of polling clients do not starve
+// the ones with work to do. Each event loop owns its own SO_REUSEPORT
+// listener and epoll set; handlers run on the loop that read the request,
+// and pipelined requests are answered in order.
+//
+// The registration API mirrors httplib::Server (same Handler and Request /
+// Response types), so TreeAPI::setupRoutes() installs the very same
+// handlers on either front end. Linux only; listen() fails elsewhere.
+//
+// A handler waiting on another thread's progress defers instead of blocking
+// its loop: the request is parked and run again once that progress is
+// signalled through resume_deferred().
+class EventLoopServer {
+public:
+    using Handler = httplib::Server::Handler;
+    using HandlerResponse = httplib::Server::HandlerResponse;
+    using HandlerWithResponse = httplib::Server::HandlerWithResponse;
+
+    EventLoopServer() = default;
+    ~EventLoopServer();
+
+    EventLoopServer(const EventLoopServer&) = delete;
+    EventLoopServer& operator=(const EventLoopServer&) = delete;
+
+    EventLoopServer& Get(const std::string& pattern, Handler handler);
+    EventLoopServer& Post(const std::string& pattern, Handler handler);
+    EventLoopServer& Put(const std::string& pattern, Handler handler);
+    EventLoopServer& Delete(const std::string& pattern, Handler handler);
+    EventLoopServer& Options(const std::string& pattern, Handler handler);
+    EventLoopServer& set_pre_routing_handler(HandlerWithResponse handler);
+
+    // 0 = one loop per hardware thread
+    EventLoopServer& set_event_loops(size_t count);
+    EventLoopServer& set_keep_alive_max_count(size_t count);
+    EventLoopServer& set_keep_alive_timeout(time_t sec);
+    EventLoopServer& set_read_timeout(time_t sec, time_t usec = 0);
+    EventLoopServer& set_write_timeout(time_t sec, time_t usec = 0);
+    EventLoopServer& set_payload_max_length(size_t length);
+
+    // Blocks until stop() like httplib::Server::listen()
+    bool listen(const std::string& host, int port);
+    void stop();
+    bool is_running() const { return running_; }
+
+    // From a handler on a loop: leave this response unsent and return true.
+    // The loop holds the connection's later requests and runs the same
+    // request again after every resume_deferred() and a last time once
+    // timeout (counted from the first deferral) has passed; that run, or
+    // any call off a loop thread, gets false and must answer.
+    static bool defer(std::chrono::milliseconds timeout);
+    // True once the running handler has deferred its response
+    static bool deferred();
+    // Any thread: wake the loops to re-run their deferred requests
+    void resume_deferred();
+
+private:
+    struct Route {
+        std::string method;
+        std::regex pattern;
+        Handler handler;
+    };
+    struct Connection;
+    struct Parked;
+    struct Deferral;
+
+    EventLoopServer& addRoute(const char* method, const std::string& pattern, Handler handler);
+    void runLoop(int listenFd, int wakeFd);
+    bool readFrom(Connection& conn);
+    void processRequests(Connection& conn);
+    bool flush(Connection& conn);
+    void dispatch(httplib::Request& req, httplib::Response& res);
+    void respond(Connection& conn, httplib::Request& req, bool keepAlive, Deferral& deferral);
+    void writeResponse(Connection& conn, const httplib::Response& res, bool keepAlive);
+    void writeError(Connection& conn, int status);
+
+    std::vector<Route> routes_;
+    HandlerWithResponse preRouting_;
+
+    size_t eventLoops_ = 0;
+    size_t keepAliveMaxCount_ = 100;
+    std::chrono::microseconds keepAliveTimeout_ = std::chrono::seconds(5);
+    std::chrono::microseconds readTimeout_ = std::chrono::seconds(5);
+    std::chrono::microseconds writeTimeout_ = std::chrono::seconds(5);
+    size_t payloadMaxLength_ = 1 << 20;
+
+    std::atomic<bool> running_{false};
+    std::vector<int> wakeFds_;
+    // Requests parked across all loops; resume_deferred() skips the wakeups at 0
+    std::atomic<size_t> parked_{0};
+    // The deferral state of the handler running on this thread, if any
+    static thread_local Deferral* currentDeferral_;
+};
@@ -0,0 +1,140 @@
+#include "server_config.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// Values below minimum, or beyond what T holds, are ignored like typos
+template<typename T>
+void readEnv(const char* name, T& value, long long minimum = 0) {
+    const char* env = std::getenv(name);
+    if (!env || !*env) return;
+    char* end = nullptr;
+    errno = 0;
+    long long parsed = std::strtoll(env, &end, 10);
+    if (*end != '\0') {
+        std::cerr << "Ignoring " << name << "=" << env << " (not a number)" << std::endl;
+        return;
+    }
+    const bool inRange = errno != ERANGE && parsed >= minimum &&
+        (parsed < 0 || static_cast<unsigned long long>(parsed) <=
+                           static_cast<unsigned long long>(std::numeric_limits<T>::max()));
+    if (!inRange) {
+        std::cerr << "Ignoring " << name << "=" << env << " (out of range)" << std::endl;
+        return;
+    }
+    value = static_cast<T>(parsed);
+}
+
+} // namespace
+
+ServerConfig ServerConfig::fromEnvironment() {
+    ServerConfig config;
+    readEnv("PORT", config.port);
+    if (const char* frontend = std::getenv("RBT_FRONTEND")) {
+        config.frontend = frontend;
+    }
+    readEnv("RBT_WORKER_THREADS", config.workerThreads);
+    readEnv("RBT_EVENT_LOOPS", config.eventLoops);
+    // An idle connection costs the epoll front end a descriptor and a
+    // buffer rather than a pool thread, so it keeps them open: no request
+    // limit and a minute of idle time unless set explicitly
+    if (config.frontend == "epoll") {
+        config.keepAliveMaxCount = 0;
+        config.keepAliveTimeoutSec = 60;
+    }
+    readEnv("RBT_KEEPALIVE_MAX_COUNT", config.keepAliveMaxCount);
+    readEnv("RBT_KEEPALIVE_TIMEOUT", config.keepAliveTimeoutSec);
+    readEnv("RBT_READ_TIMEOUT", config.readTimeoutSec);
+    readEnv("RBT_WRITE_TIMEOUT", config.writeTimeoutSec);
+    readEnv("RBT_PAYLOAD_MAX", config.payloadMaxLength);
+    readEnv("RBT_PARALLEL_THREADS", config.parallelThreads);
+    readEnv("RBT_PARALLEL_CUTOFF", config.parallelCutoff, -1);
+    readEnv("RBT_GZIP", config.gzipResponses);
+    if (const char* engine = std::getenv("RBT_ENGINE")) {
+        config.engine = engine;
+    }
+    if (const char* keyType = std::getenv("RBT_KEY_TYPE")) {
+        config.keyType = keyType;
+    }
+    if (const char* capture = std::getenv("RBT_CAPTURE")) {
+        config.captureFile = capture;
+    }
+    readEnv("RBT_DEFAULT_TTL", config.defaultTtlSec);
+    readEnv("RBT_MEMORY_CAP_MB", config.memoryCapMb);
+    if (const char* eviction = std::getenv("RBT_EVICTION")) {
+        config.eviction = eviction;
+    }
+    readEnv("RBT_EXPIRY_TICK_MS", config.expiryTickMs);
+    readEnv("RBT_REPLICATION_PORT", config.replicationPort);
+    if (const char* leader = std::getenv("RBT_REPLICATE_FROM")) {
+        config.replicateFrom = leader;
+    }
+    readEnv("RBT_REPLICATION_LOG", config.replicationLog);
+    readEnv("RBT_READ_WAIT_MS", config.readWaitMs);
+    readEnv("RBT_WRITE_COMBINING", config.writeCombining);
+    return config;
+}
+
+RetentionConfig ServerConfig::retention() const {
+    RetentionConfig retention;
+    retention.defaultTtl = std::chrono::seconds(defaultTtlSec);
+    retention.memoryCapBytes = memoryCapMb << 20;
+    retention.eviction = eviction == "oldest" ? EvictionPolicy::Oldest : EvictionPolicy::Lru;
+    retention.tick = std::chrono::milliseconds(std::max<size_t>(expiryTickMs, 1));
+    return retention;
+}
+
+void ServerConfig::apply(httplib::Server& server) const {
+    if (workerThreads > 0) {
+        const size_t threads = workerThreads;
+        server.new_task_queue = [threads] { return new httplib::ThreadPool(threads); };
+    }
+    server.set_keep_alive_max_count(keepAliveMaxCount);
+    server.set_keep_alive_timeout(keepAliveTimeoutSec);
+    server.set_read_timeout(readTimeoutSec, 0);
+    server.set_write_timeout(writeTimeoutSec, 0);
+    server.set_payload_max_length(payloadMaxLength);
+}
+
+void ServerConfig::apply(EventLoopServer& server) const {
+    server.set_event_loops(eventLoops);
+    server.set_keep_alive_max_count(keepAliveMaxCount);
+    server.set_keep_alive_timeout(keepAliveTimeoutSec);
+    server.set_read_timeout(readTimeoutSec);
+    server.set_write_timeout(writeTimeoutSec);
+    server.set_payload_max_length(payloadMaxLength);
+}
+
+void ServerConfig::print() const {
+    std::cout << "Front end: " << frontend;
+    if (frontend == "epoll") {
+        std::cout << " (" << (eventLoops ? std::to_string(eventLoops) : "auto") << " event loops)";
+    } else {
+        std::cout << " (" << (workerThreads ? std::to_string(workerThreads) : "default") << " worker threads)";
+    }
+    std::cout << std::endl;
+    std::cout << "Keep-alive: max "
+              << (keepAliveMaxCount ? std::to_string(keepAliveMaxCount) : "unlimited") << " requests, "
+              << keepAliveTimeoutSec << "s idle" << std::endl;
+    std::cout << "Index engine: " << engine << ", " << keyType << " keys" << std::endl;
+    if (!captureFile.empty()) {
+        std::cout << "Capturing workload to " << captureFile << std::endl;
+    }
+    std::cout << "Retention: default TTL " << (defaultTtlSec ? std::to_string(defaultTtlSec) + "s" : "none")
+              << ", memory cap " << (memoryCapMb ? std::to_string(memoryCapMb) + " MB (" + eviction + ")" : "none")
+              << std::endl;
+    if (replicationPort > 0) {
+        std::cout << "Replication: leader on port " << replicationPort << ", "
+                  << replicationLog << " commits kept" << std::endl;
+    } else if (!replicateFrom.empty()) {
+        std::cout << "Replication: read-only follower of " << replicateFrom << std::endl;
+    }
+    std::cout << "Write combining: " << (writeCombining ? "on" : "off") << std::endl;
+    std::cout << "Response cache: on, gzip " << (gzipResponses ? "on" : "off") << std::endl;
+    std::cout << "Timeouts: read " << readTimeoutSec << "s, write " << writeTimeoutSec
+              << "s; max payload " << payloadMaxLength << " bytes" << std::endl;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "httplib.h"
+#include "event_loop_server.h"
+#include "../api/key_retention.h"
+#include <cstddef>
+#include <ctime>
+#include <string>
+
+// Every server knob, read from the environment at startup. Unset variables
+// keep the defaults below, which match httplib's own except for the payload
+// limit (requests here are tiny JSON bodies). The epoll front end keeps
+// idle connections open longer; see fromEnvironment().
+struct ServerConfig {
+    int port = 8080;                 // PORT
+    std::string frontend = "threaded"; // RBT_FRONTEND: "threaded" (httplib) or "epoll"
+    size_t workerThreads = 0;        // RBT_WORKER_THREADS: httplib pool size, 0 = httplib default
+    size_t eventLoops = 0;           // RBT_EVENT_LOOPS: epoll loops, 0 = hardware threads
+    size_t keepAliveMaxCount = 5;    // RBT_KEEPALIVE_MAX_COUNT: requests per connection, 0 = unlimited (epoll)
+    time_t keepAliveTimeoutSec = 5;  // RBT_KEEPALIVE_TIMEOUT
+    time_t readTimeoutSec = 5;       // RBT_READ_TIMEOUT
+    time_t writeTimeoutSec = 5;      // RBT_WRITE_TIMEOUT
+    size_t payloadMaxLength = 1 << 20; // RBT_PAYLOAD_MAX: bytes
+    size_t parallelThreads = 0;      // RBT_PARALLEL_THREADS: 0 = hardware threads
+    int parallelCutoff = -1;         // RBT_PARALLEL_CUTOFF: -1 = automatic
+    bool gzipResponses = false;      // RBT_GZIP: gzip cached read responses (needs zlib)
+    std::string engine = "rb";       // RBT_ENGINE: ordered index, "rb", "avl", "bplus" or "rb-stats"
+    std::string keyType = "int64";   // RBT_KEY_TYPE: "int64" or "string"
+    std::string captureFile;         // RBT_CAPTURE: workload trace path, empty = off
+    size_t defaultTtlSec = 0;        // RBT_DEFAULT_TTL: seconds, 0 = keys never expire
+    size_t memoryCapMb = 0;          // RBT_MEMORY_CAP_MB: estimated index footprint, 0 = unbounded
+    std::string eviction = "lru";    // RBT_EVICTION: "lru" or "oldest", once the cap is reached
+    size_t expiryTickMs = 100;       // RBT_EXPIRY_TICK_MS: TTL resolution
+    int replicationPort = 0;         // RBT_REPLICATION_PORT: lead followers on this port, 0 = off
+    std::string replicateFrom;       // RBT_REPLICATE_FROM: "host:port" of a leader to follow read-only
+    size_t replicationLog = 100000;  // RBT_REPLICATION_LOG: commits kept for followers to catch up from
+    size_t readWaitMs = 1000;        // RBT_READ_WAIT_MS: longest a ?minVersion= read waits
+    bool writeCombining = true;      // RBT_WRITE_COMBINING: batch concurrent inserts, 0 = lock per insert
+
+    static ServerConfig fromEnvironment();
+    // The retention knobs for TreeAPI; eviction must already be valid
+    RetentionConfig retention() const;
+
+    void apply(httplib::Server& server) const;
+    void apply(EventLoopServer& server) const;
+    void print() const;
+};
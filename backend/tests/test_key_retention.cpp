@@ -0,0 +1,177 @@
+#include "api/key_retention.h"
+#include "rbtree/string_key.h"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+
+using namespace std::chrono_literals;
+using Retention = KeyRetention<int64_t>;
+
+static RetentionConfig makeConfig(size_t capBytes = 0, EvictionPolicy eviction = EvictionPolicy::Lru) {
+    RetentionConfig config;
+    config.tick = 10ms;
+    config.expireBatch = 100;
+    config.memoryCapBytes = capBytes;
+    config.eviction = eviction;
+    return config;
+}
+
+void test_ttl_expiry() {
+    const auto t0 = Retention::Clock::time_point{} + 1h;
+    Retention retention(makeConfig(), t0);
+    std::set<int64_t> live;
+    auto remove = [&live](int64_t key) {
+        assert(live.erase(key) == 1 && "Only live keys should be removed");
+    };
+
+    // Keys without a TTL are not tracked when there is no cap
+    for (int64_t k = 0; k < 50; k++) {
+        live.insert(k);
+        retention.added(k, 64, k < 25 ? 0ms : std::chrono::milliseconds(10 * (k - 24)), t0);
+    }
+    assert(retention.tracked() == 25 && retention.pending() == 25);
+    assert(retention.bytes() == 25 * 64);
+
+    // Nothing is due early, even one millisecond short
+    assert(retention.expire(t0 + 9ms, remove) == 0);
+    assert(retention.expire(t0 + 10ms, remove) == 1 && live.count(25) == 0);
+    assert(retention.expire(t0 + 100ms, remove) == 9);
+    assert(live.size() == 40 && retention.tracked() == 15);
+
+    // Deleting a key or restarting its TTL leaves a stale timer that never fires
+    retention.removed(40);
+    live.erase(40);
+    retention.refreshed(41, 1000ms, t0 + 100ms);
+    retention.refreshed(42, 0ms, t0 + 100ms);
+    assert(retention.expire(t0 + 400ms, remove) == 12);
+    assert(live.count(41) == 1 && live.count(42) == 1 && retention.tracked() == 1);
+    assert(retention.expire(t0 + 1100ms, remove) == 1 && live.count(41) == 0);
+    assert(retention.pending() == 0 && retention.tracked() == 0 && retention.bytes() == 0);
+    assert(retention.expiredTotal() == 23);
+    assert(live.size() == 26);
+}
+
+void test_batches_and_laps() {
+    const auto t0 = Retention::Clock::time_point{} + 1h;
+    Retention retention(makeConfig(), t0);
+    size_t removed = 0;
+    auto count = [&removed](int64_t) { removed++; };
+
+    // 250 keys due in one tick come out 100 at a time
+    for (int64_t k = 0; k < 250; k++) retention.added(k, 8, 50ms, t0);
+    assert(retention.expire(t0 + 60ms, count) == 100);
+    assert(retention.expire(t0 + 60ms, count) == 100);
+    assert(retention.expire(t0 + 60ms, count) == 50);
+    assert(retention.expire(t0 + 60ms, count) == 0 && removed == 250);
+
+    // A deadline more than a lap of the wheel away waits for its own lap
+    const auto lap = Retention::kWheelSlots * 10ms;
+    retention.added(1000, 8, lap + 30ms, t0 + 60ms);
+    assert(retention.expire(t0 + 60ms + lap, count) == 0);
+    assert(retention.expire(t0 + 100ms + lap, count) == 1 && removed == 251);
+
+    // The default TTL applies unless the caller overrides it
+    RetentionConfig config = makeConfig();
+    config.defaultTtl = 20ms;
+    Retention withDefault(config, t0);
+    withDefault.added(1, 8, Retention::kDefaultTtl, t0);
+    withDefault.added(2, 8, 0ms, t0);
+    assert(withDefault.tracked() == 1);
+    assert(withDefault.expire(t0 + 20ms, count) == 1 && removed == 252);
+
+    withDefault.added(3, 8, 20ms, t0);
+    withDefault.cleared();
+    assert(withDefault.pending() == 0 && withDefault.tracked() == 0);
+    assert(withDefault.expire(t0 + 1s, count) == 0);
+}
+
+void test_oldest_eviction() {
+    const auto t0 = Retention::Clock::time_point{} + 1h;
+    Retention retention(makeConfig(1000, EvictionPolicy::Oldest), t0);
+    std::set<int64_t> live;
+    auto remove = [&live](int64_t key) { assert(live.erase(key) == 1); };
+
+    // With a cap every key is tracked, TTL or not
+    for (int64_t k = 0; k < 10; k++) {
+        live.insert(k);
+        retention.added(k, 100, 0ms, t0);
+        assert(retention.evict(remove) == 0);
+    }
+    retention.touched(0);  // ignored by Oldest
+    live.insert(10);
+    retention.added(10, 100, 0ms, t0);
+    assert(retention.evict(remove) == 1 && live.count(0) == 0);
+
+    // A deleted key gives its bytes back and is skipped in the queue
+    retention.removed(1);
+    live.erase(1);
+    live.insert(11);
+    retention.added(11, 100, 0ms, t0);
+    assert(retention.evict(remove) == 0);
+    live.insert(12);
+    retention.added(12, 250, 0ms, t0);
+    assert(retention.evict(remove) == 3);
+    assert(live.count(2) == 0 && live.count(3) == 0 && live.count(4) == 0);
+    assert(retention.bytes() <= 1000 && retention.evictedTotal() == 4);
+}
+
+void test_lru_second_chance() {
+    const auto t0 = Retention::Clock::time_point{} + 1h;
+    Retention retention(makeConfig(500, EvictionPolicy::Lru), t0);
+    std::set<int64_t> live;
+    auto remove = [&live](int64_t key) { assert(live.erase(key) == 1); };
+
+    for (int64_t k = 0; k < 5; k++) {
+        live.insert(k);
+        retention.added(k, 100, 0ms, t0);
+    }
+    // Recently read keys survive; the oldest unread one goes
+    retention.touched(0);
+    retention.touched(1);
+    live.insert(5);
+    retention.added(5, 100, 0ms, t0);
+    assert(retention.evict(remove) == 1 && live.count(2) == 0);
+    assert(live.count(0) == 1 && live.count(1) == 1);
+
+    live.insert(6);
+    retention.added(6, 200, 0ms, t0);
+    assert(retention.evict(remove) == 2);
+    assert(live.count(3) == 0 && live.count(4) == 0);
+    live.insert(7);
+    retention.added(7, 100, 0ms, t0);
+    assert(retention.evict(remove) == 1 && live.count(5) == 0);
+
+    // Their reference is spent: now they are the oldest
+    live.insert(8);
+    retention.added(8, 100, 0ms, t0);
+    assert(retention.evict(remove) == 1 && live.count(0) == 0 && live.count(1) == 1);
+    assert(retention.tracked() == live.size() && retention.bytes() == 500);
+
+    // Expiry and the cap share one entry per key
+    retention.refreshed(7, 30ms, t0);
+    assert(retention.expire(t0 + 30ms, remove) == 1 && live.count(7) == 0);
+    assert(retention.bytes() == 400);
+}
+
+void test_string_keys() {
+    const auto t0 = KeyRetention<rbtree::StringKey>::Clock::time_point{} + 1h;
+    KeyRetention<rbtree::StringKey> retention(makeConfig(), t0);
+    std::set<std::string> removed;
+    retention.added(std::string("session/alpha"), 80, 10ms, t0);
+    retention.added(std::string("session/beta"), 80, 20ms, t0);
+    retention.expire(t0 + 15ms, [&removed](const rbtree::StringKey& key) { removed.insert(key.str()); });
+    assert(removed.size() == 1 && removed.count("session/alpha") == 1);
+    assert(retention.tracked() == 1);
+}
+
+int main() {
+    test_ttl_expiry();
+    test_batches_and_laps();
+    test_oldest_eviction();
+    test_lru_second_chance();
+    test_string_keys();
+    std::cout << "All key retention tests passed!" << std::endl;
+    return 0;
+}
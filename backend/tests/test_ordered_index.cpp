@@ -0,0 +1,186 @@
+#include "rbtree/ordered_index.h"
+#include "rbtree/string_key.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Random inserts and deletes, checked against std::set after every batch.
+template<typename Tree>
+void check_against_set(Tree& tree, bool (Tree::*valid)() const, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> key(-2000, 2000);
+    std::set<int> reference;
+
+    for (int round = 0; round < 40; round++) {
+        const bool growing = round % 4 != 3;
+        for (int i = 0; i < 500; i++) {
+            const int k = key(gen);
+            if (growing || i % 3 == 0) {
+                assert(tree.insert(k) == reference.insert(k).second && "Insert result should match std::set");
+            } else {
+                assert(tree.remove(k) == (reference.erase(k) == 1) && "Remove result should match std::set");
+            }
+        }
+        assert(tree.size() == reference.size() && "Size should match std::set");
+        assert((tree.*valid)() && "Tree should stay valid");
+        for (int probe = -2010; probe <= 2010; probe += 7) {
+            assert(tree.search(probe) == (reference.count(probe) == 1) && "Search should match std::set");
+        }
+    }
+
+    std::vector<int> keys;
+    tree.inorder([&keys](const int& k) { keys.push_back(k); });
+    assert(std::equal(keys.begin(), keys.end(), reference.begin(), reference.end()) &&
+           "Inorder should visit keys in sorted order");
+
+    // Drain completely to exercise every merge path down to an empty root
+    std::vector<int> all(reference.begin(), reference.end());
+    std::shuffle(all.begin(), all.end(), gen);
+    for (int k : all) {
+        assert(tree.remove(k) && "Every present key should be removable");
+    }
+    assert(tree.empty() && (tree.*valid)() && "Drained tree should be empty and valid");
+    assert(tree.insert(1) && tree.search(1) && "Drained tree should accept inserts");
+}
+
+void test_avl_tree() {
+    rbtree::AVLTree<int> tree;
+    check_against_set(tree, &rbtree::AVLTree<int>::isValidAVLTree, 1);
+
+    rbtree::AVLTree<int> sorted;
+    for (int i = 0; i < (1 << 12) - 1; i++) sorted.insert(i);
+    assert(sorted.height() == 12 && "Sorted inserts should give a perfectly balanced AVL tree");
+}
+
+void test_bplus_tree() {
+    // A tiny fanout forces splits and merges several levels deep
+    rbtree::BPlusTree<int, 4> narrow;
+    check_against_set(narrow, &rbtree::BPlusTree<int, 4>::isValid, 2);
+
+    rbtree::BPlusTree<int> wide;
+    check_against_set(wide, &rbtree::BPlusTree<int>::isValid, 3);
+
+    rbtree::BPlusTree<int, 64> levels;
+    for (int i = 0; i < 100000; i++) levels.insert(i);
+    assert(levels.height() <= 4 && levels.isValid() && "Wide nodes should keep the tree shallow");
+}
+
+void test_engines_behave_alike() {
+    std::mt19937 gen(4);
+    std::uniform_int_distribution<int> key(0, 5000);
+    std::vector<std::unique_ptr<rbtree::OrderedIndex<int>>> engines;
+    for (const auto& name : rbtree::indexEngines()) {
+        engines.push_back(rbtree::makeOrderedIndex<int>(name));
+        assert(engines.back() && engines.back()->engine() == name && "Factory should build every engine");
+    }
+    assert(!rbtree::makeOrderedIndex<int>("skiplist") && "Unknown engines should be rejected");
+
+    for (int i = 0; i < 20000; i++) {
+        const int k = key(gen);
+        const bool insert = i % 3 != 0;
+        const bool expected = insert ? engines[0]->insert(k) : engines[0]->remove(k);
+        for (size_t e = 1; e < engines.size(); e++) {
+            const bool changed = insert ? engines[e]->insert(k) : engines[e]->remove(k);
+            assert(changed == expected && "Engines should agree on every update");
+        }
+    }
+
+    std::vector<int> expected;
+    engines[0]->forEach([&expected](const int& k) { expected.push_back(k); });
+    for (auto& engine : engines) {
+        std::vector<int> keys;
+        engine->forEach([&keys](const int& k) { keys.push_back(k); });
+        assert(keys == expected && engine->validate() && "Engines should hold the same keys");
+    }
+    assert(engines[0]->redBlackTree() && !engines[1]->redBlackTree() && !engines[2]->redBlackTree() &&
+           !engines[3]->redBlackTree() && engines[3]->statsRedBlackTree() && !engines[0]->statsRedBlackTree() &&
+           "Only the red-black engines expose their nodes");
+
+    // Indexed range stats must agree with the scanning fallback
+    assert(engines[3]->indexedRangeStats() && !engines[0]->indexedRangeStats());
+    for (int i = 0; i < 500; i++) {
+        const int from = key(gen) - 100;
+        const int to = from + key(gen) / 4;
+        const int* lo = i % 10 ? &from : nullptr;
+        const int* hi = i % 7 ? &to : nullptr;
+        const auto reference = engines[0]->rangeStats(lo, hi);
+        assert((reference.count == 0) == (reference.min == nullptr) && "Empty ranges have no min");
+        for (auto& engine : engines) {
+            const auto stats = engine->rangeStats(lo, hi);
+            assert(stats.count == reference.count && stats.sum == reference.sum &&
+                   (stats.count == 0 || (*stats.min == *reference.min && *stats.max == *reference.max)) &&
+                   "Engines should agree on range stats");
+        }
+    }
+}
+
+void test_string_key_order() {
+    using rbtree::StringKey;
+    // Short keys, shared 8-byte prefixes, embedded NULs and high bytes
+    std::vector<std::string> words = {
+        "", "a", "ab", std::string("ab\0", 3), std::string("ab\0\0\0\0\0\0", 8),
+        std::string("ab\0\0\0\0\0\0x", 9), "abcdefgh", "abcdefghi", "abcdefgha",
+        "abcdefgz", "user:0000000017", "user:0000000170", "user:00000001", "\xff", "\xfe\xff",
+        "zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz", "zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzy"};
+    for (const auto& a : words) {
+        for (const auto& b : words) {
+            assert((StringKey(a) < StringKey(b)) == (a < b) && "StringKey should order like std::string");
+            assert((StringKey(a) == StringKey(b)) == (a == b) && "StringKey equality should match std::string");
+        }
+    }
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> id(0, 3000);
+    for (const auto& engine : rbtree::indexEngines()) {
+        auto index = rbtree::makeOrderedIndex<StringKey>(engine);
+        std::set<std::string> reference;
+        for (int i = 0; i < 6000; i++) {
+            const std::string key = "customer-" + std::to_string(id(gen));
+            if (i % 4 == 3) {
+                assert(index->remove(key) == (reference.erase(key) == 1) && "String remove should match std::set");
+            } else {
+                assert(index->insert(key) == reference.insert(key).second && "String insert should match std::set");
+            }
+        }
+        std::vector<std::string> keys;
+        index->forEach([&keys](const StringKey& k) { keys.push_back(k.str()); });
+        assert(std::equal(keys.begin(), keys.end(), reference.begin(), reference.end()) &&
+               index->validate() && "String keys should iterate in std::string order");
+    }
+
+    rbtree::RedBlackTree<StringKey> tree;
+    tree.insert(std::string("say \"hi\"\n"));
+    assert(tree.toJSON().find("\"data\":\"say \\\"hi\\\"\\u000a\"") != std::string::npos &&
+           "String keys should be escaped in toJSON");
+}
+
+void test_int64_keys() {
+    const int64_t big = int64_t(1) << 40;
+    for (const auto& engine : rbtree::indexEngines()) {
+        auto index = rbtree::makeOrderedIndex<int64_t>(engine);
+        for (int64_t k : {big, -big, int64_t(0), -int64_t(7), big + 1}) index->insert(k);
+        std::vector<int64_t> keys;
+        index->forEach([&keys](const int64_t& k) { keys.push_back(k); });
+        assert((keys == std::vector<int64_t>{-big, -7, 0, big, big + 1}) && index->contains(-7) &&
+               !index->contains(7) && "Negative and 64-bit keys should order correctly");
+    }
+}
+
+int main() {
+    try {
+        test_avl_tree();
+        test_bplus_tree();
+        test_engines_behave_alike();
+        test_string_key_order();
+        test_int64_keys();
+        std::cout << "All ordered index tests passed!" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,9 +1,14 @@
 #include "rbtree/tree.h"
+#include "rbtree/flat_combining.h"
 #include <iostream>
 #include <vector>
 #include <cassert>
 #include <random>
 #include <algorithm>
+#include <set>
+#include <string>
+#include <stdexcept>
+#include <thread>
 
 void test_insert_and_search() {
     rbtree::RedBlackTree<int> tree;
@@ -184,6 +189,327 @@ void test_edge_cases() {
     assert(tree.empty() && "Should be empty after removing all values");
 }
 
+void test_whole_tree_operations() {
+    rbtree::RedBlackTree<int> tree;
+    assert(tree.height() == 0 && "Empty tree should have height 0");
+    assert(tree.toJSON() == "null" && "Empty tree should serialize to null");
+    assert(tree.getAllNodes().empty() && "Empty tree should have no nodes");
+
+    for (int val : {1, 2, 3}) {
+        tree.insert(val);
+    }
+    tree.updateLayout();
+    const std::string expected =
+        "{\"data\":2,\"color\":\"black\",\"x\":80,\"y\":0,"
+        "\"left\":{\"data\":1,\"color\":\"red\",\"x\":0,\"y\":100,\"left\":null,\"right\":null},"
+        "\"right\":{\"data\":3,\"color\":\"red\",\"x\":160,\"y\":100,\"left\":null,\"right\":null}}";
+    assert(tree.toJSON() == expected && "JSON should match the nested layout");
+    assert(tree.height() == 2 && "Three balanced nodes should have height 2");
+
+    auto nodes = tree.getAllNodes();
+    assert(nodes.size() == 3 && nodes[0]->data == 2 && nodes[1]->data == 1 &&
+           nodes[2]->data == 3 && "getAllNodes should return preorder");
+
+    // Deep enough that the old recursive helpers would have been the hot path;
+    // the iterative versions must agree on every invariant.
+    tree.clear();
+    const int LARGE_SIZE = 200000;
+    for (int i = 0; i < LARGE_SIZE; i++) {
+        tree.insert(i);
+    }
+    assert(tree.isValidRBTree() && "Sequential inserts should keep the tree valid");
+    assert(tree.getAllNodes().size() == static_cast<size_t>(LARGE_SIZE) && "Should collect every node");
+    int h = tree.height();
+    assert(h >= 18 && h <= 2 * 18 && "Height should stay logarithmic");
+
+    int expectedNext = 0;
+    tree.inorder([&expectedNext](const int& val) {
+        assert(val == expectedNext && "Inorder should visit keys in order");
+        expectedNext++;
+    });
+    assert(expectedNext == LARGE_SIZE && "Inorder should visit every key");
+
+    tree.updateLayout();
+    nodes = tree.getAllNodes();
+    for (auto node : nodes) {
+        assert(node->x == node->data * 80 && "Layout x should follow inorder rank");
+        assert(node->y == node->level * 100 && "Layout y should follow depth");
+    }
+
+    // Break the black-height invariant and make sure validation notices.
+    tree.getRoot()->left->isRed = !tree.getRoot()->left->isRed;
+    assert(!tree.isValidRBTree() && "Recoloring a child of the root should invalidate the tree");
+}
+
+void test_parallel_matches_sequential() {
+    rbtree::RedBlackTree<int> tree;
+    rbtree::WorkStealingPool pool(4);
+
+    // Empty and tiny trees, where the cutoff reaches past the leaves
+    for (int cutoff : {0, 1, 3, 10}) {
+        assert(tree.height(pool, cutoff) == tree.height() && "Parallel height should match on empty tree");
+        assert(tree.isValidRBTree(pool, cutoff) && "Empty tree should be valid in parallel");
+        assert(tree.toJSON(pool, cutoff) == tree.toJSON() && "Parallel JSON should match on empty tree");
+    }
+    for (int val : {5, 3, 8}) {
+        tree.insert(val);
+    }
+    for (int cutoff : {0, 1, 3, 10}) {
+        assert(tree.getAllNodes(pool, cutoff) == tree.getAllNodes() && "Parallel nodes should match on tiny tree");
+        assert(tree.toJSON(pool, cutoff) == tree.toJSON() && "Parallel JSON should match on tiny tree");
+    }
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> dis(0, 1000000);
+    for (int i = 0; i < 50000; i++) {
+        tree.insert(dis(gen));
+    }
+    tree.updateLayout();
+
+    const int height = tree.height();
+    const auto nodes = tree.getAllNodes();
+    const std::string json = tree.toJSON();
+    for (int cutoff : {0, 1, 4, 8, 64}) {
+        assert(tree.height(pool, cutoff) == height && "Parallel height should match");
+        assert(tree.isValidRBTree(pool, cutoff) && "Parallel validation should accept a valid tree");
+        assert(tree.getAllNodes(pool, cutoff) == nodes && "Parallel nodes should keep preorder");
+        assert(tree.toJSON(pool, cutoff) == json && "Parallel JSON should be byte-identical");
+    }
+
+    // Invalidate a node deep enough to land inside a subtree task
+    rbtree::RBNode<int>* deep = tree.getRoot();
+    for (int i = 0; i < 6; i++) {
+        deep = deep->left;
+    }
+    deep->isRed = !deep->isRed;
+    for (int cutoff : {0, 2, 6, 7, 64}) {
+        assert(tree.isValidRBTree(pool, cutoff) == tree.isValidRBTree() &&
+               "Parallel validation should agree on an invalid tree");
+    }
+    assert(!tree.isValidRBTree() && "Recolored tree should be invalid");
+    deep->isRed = !deep->isRed;
+}
+
+// Non-commutative monoid: catches any combine that loses key order
+struct ConcatAugment {
+    static constexpr bool enabled = true;
+    using value_type = std::string;
+    static value_type identity() { return ""; }
+    static value_type fromKey(int key) { return std::to_string(key) + ","; }
+    static value_type combine(const value_type& left, const value_type& right) { return left + right; }
+};
+
+void test_augmented_aggregates() {
+    // The default policy must not change the node layout
+    struct PlainNode {
+        int data;
+        PlainNode* left;
+        PlainNode* right;
+        PlainNode* parent;
+        bool isRed;
+        int x, y;
+        int level;
+    };
+    static_assert(sizeof(rbtree::RBNode<int>) == sizeof(PlainNode), "NoAugment should add no bytes");
+
+    using Stats = rbtree::KeyStatsAugment<int>;
+    rbtree::RedBlackTree<int, Stats> tree;
+    rbtree::RedBlackTree<int, ConcatAugment> ordered;
+    std::set<int> reference;
+
+    auto empty = tree.aggregate(nullptr, nullptr);
+    assert(empty.count == 0 && empty.min == nullptr && "Empty tree should aggregate to identity");
+
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> dis(-2000, 2000);
+    for (int round = 0; round < 4000; round++) {
+        int key = dis(gen);
+        if (round % 3 == 2) {
+            tree.remove(key);
+            ordered.remove(key);
+            reference.erase(key);
+        } else {
+            tree.insert(key);
+            ordered.insert(key);
+            reference.insert(key);
+        }
+        if (round % 200 == 0) {
+            assert(tree.isValidRBTree() && "Summaries should survive rotations and fixups");
+            assert(ordered.isValidRBTree() && "Ordered summaries should survive rotations and fixups");
+        }
+
+        int from = dis(gen);
+        int to = from + dis(gen) % 600;
+        size_t count = 0;
+        long long sum = 0;
+        std::string concat;
+        for (auto it = reference.lower_bound(from); it != reference.end() && *it <= to; ++it) {
+            count++;
+            sum += *it;
+            concat += std::to_string(*it) + ",";
+        }
+        auto stats = tree.aggregate(from, to);
+        assert(stats.count == count && "Range count should match brute force");
+        assert(static_cast<long long>(stats.sum) == sum && "Range sum should match brute force");
+        if (count > 0) {
+            assert(*stats.min == *reference.lower_bound(from) && "Range min should match brute force");
+            assert(*stats.max == *std::prev(reference.upper_bound(to)) && "Range max should match brute force");
+        } else {
+            assert(stats.min == nullptr && stats.max == nullptr && "Empty range has no min or max");
+        }
+        assert(ordered.aggregate(from, to) == concat && "Summaries should combine in key order");
+    }
+
+    // Open and inverted bounds
+    int pivot = 0;
+    auto below = tree.aggregate(nullptr, &pivot);
+    auto above = tree.aggregate(&pivot, nullptr);
+    auto all = tree.aggregate(nullptr, nullptr);
+    assert(all.count == reference.size() && "Whole-tree count should match");
+    assert(below.count + above.count == all.count + reference.count(pivot) && "Open bounds should split the tree");
+    assert(tree.aggregate(10, -10).count == 0 && "Inverted range should be empty");
+
+    // A stale cached summary is reported as invalid
+    auto* node = tree.getRoot()->left;
+    node->summary.count++;
+    assert(!tree.isValidRBTree() && "Corrupted summary should fail validation");
+    rbtree::WorkStealingPool pool(2);
+    assert(!tree.isValidRBTree(pool, 3) && "Parallel validation should check summaries too");
+    node->summary.count--;
+    assert(tree.isValidRBTree() && "Restored summary should validate");
+}
+
+// Counts copies so node transfers can prove they never copy a key
+struct Tracked {
+    static int copies;
+    int key;
+    Tracked() : key(0) {}
+    Tracked(int k) : key(k) {}
+    Tracked(const Tracked& other) : key(other.key) { copies++; }
+    Tracked(Tracked&& other) noexcept : key(other.key) {}
+    Tracked& operator=(const Tracked& other) { key = other.key; copies++; return *this; }
+    Tracked& operator=(Tracked&& other) noexcept { key = other.key; return *this; }
+    bool operator<(const Tracked& other) const { return key < other.key; }
+    bool operator==(const Tracked& other) const { return key == other.key; }
+};
+int Tracked::copies = 0;
+
+void test_node_handles() {
+    rbtree::RedBlackTree<Tracked> source;
+    rbtree::RedBlackTree<Tracked> archive;
+    for (int i = 0; i < 1000; i++) {
+        source.insert(Tracked(i));
+    }
+    assert(Tracked::copies == 0 && "Rvalue inserts should move the key into the node");
+
+    // extract + insert relinks the very same node
+    auto handle = source.extract(Tracked(500));
+    assert(handle && handle.value().key == 500 && source.size() == 999 && !source.search(Tracked(500)));
+    const Tracked* address = &handle.value();
+    auto result = archive.insert(std::move(handle));
+    assert(result.inserted && result.node.empty() && archive.search(Tracked(500)) && "Handle should relink");
+    assert(&archive.getRoot()->data == address && "Relinked node should not be reallocated");
+    assert(!source.extract(Tracked(500)) && "Extracting a missing key gives an empty handle");
+
+    // Keys can be changed while the node is out of any tree
+    auto moved = source.extract(Tracked(10));
+    moved.value().key = 5000;
+    assert(source.insert(std::move(moved)).inserted && source.search(Tracked(5000)) && !source.search(Tracked(10)));
+
+    // A duplicate hands the node back instead of dropping it
+    archive.insert(Tracked(20));
+    auto duplicate = source.extract(Tracked(20));
+    auto refused = archive.insert(std::move(duplicate));
+    assert(!refused.inserted && refused.node && refused.node.value().key == 20 && "Duplicate should come back");
+
+    // merge splices every new key and leaves duplicates behind
+    std::vector<rbtree::RBNode<Tracked>*> before = source.getAllNodes();
+    const auto archived = archive.getAllNodes();
+    before.insert(before.end(), archived.begin(), archived.end());
+    for (int i = 900; i < 1100; i++) {
+        archive.insert(Tracked(i));
+    }
+    const size_t expected = 1100;  // 0..1099 without 10, plus 5000
+    archive.merge(source);
+    assert(archive.size() == expected && "Merge should move every new key");
+    assert(source.size() == 100 && "Keys already in the target stay in the source");
+    for (int i = 900; i < 1000; i++) {
+        assert(source.search(Tracked(i)) && "Only duplicates should stay behind");
+    }
+    assert(archive.isValidRBTree() && source.isValidRBTree() && "Both trees should stay balanced");
+    const auto after = archive.getAllNodes();
+    for (auto* node : after) {
+        if (node->data.key >= 900 && node->data.key < 1100) continue;
+        assert(std::find(before.begin(), before.end(), node) != before.end() && "Merged nodes should be reused");
+    }
+    assert(Tracked::copies == 0 && "No transfer should copy a key");
+    archive.merge(archive);
+    assert(archive.size() == expected && "Self-merge is a no-op");
+
+    // Augmented summaries follow the nodes across trees
+    rbtree::RedBlackTree<int, rbtree::CountAugment<int>> left, right;
+    for (int i = 0; i < 500; i++) {
+        (i % 2 ? left : right).insert(i);
+    }
+    right.insert(left.extract(99));
+    left.merge(right);
+    assert(left.size() == 500 && right.empty() && left.aggregate(100, 199) == 100 && left.isValidRBTree() &&
+           "Merged augmented tree should keep valid summaries");
+}
+
+void test_flat_combining() {
+    struct Op {
+        int key;
+        bool inserted = false;
+    };
+    rbtree::RedBlackTree<int> tree;
+    rbtree::FlatCombiner<Op> combiner(4);  // fewer slots than threads
+    auto apply = [&tree](std::vector<Op*>& batch) {
+        std::sort(batch.begin(), batch.end(), [](const Op* a, const Op* b) { return a->key < b->key; });
+        for (Op* op : batch) {
+            op->inserted = !tree.search(op->key);
+            if (op->inserted) tree.insert(op->key);
+        }
+    };
+
+    // Every caller gets its own result back: a unique key is always new and
+    // each shared key is new for exactly one caller
+    const int threads = 8, perThread = 2000, shared = 100;
+    std::vector<int> wins(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < perThread; i++) {
+                Op unique{1000000 + t * perThread + i};
+                combiner.execute(unique, apply);
+                assert(unique.inserted && "A unique key should be reported as inserted");
+                Op contended{i % shared};
+                combiner.execute(contended, apply);
+                wins[t] += contended.inserted;
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    int totalWins = 0;
+    for (int w : wins) totalWins += w;
+    assert(totalWins == shared && "Each shared key should be inserted by exactly one caller");
+    assert(tree.size() == static_cast<size_t>(threads * perThread + shared) && tree.isValidRBTree());
+    assert(combiner.ops() == static_cast<uint64_t>(2 * threads * perThread));
+    assert(combiner.batches() > 0 && combiner.batches() <= combiner.ops());
+
+    // A failed batch fails its callers, and the combiner keeps working
+    Op op{-1};
+    bool threw = false;
+    try {
+        combiner.execute(op, [](std::vector<Op*>&) { throw std::runtime_error("apply failed"); });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw && "The batch's exception should reach the caller");
+    combiner.execute(op, apply);
+    assert(op.inserted && tree.search(-1));
+}
+
 int main() {
     try {
         test_insert_and_search();
@@ -192,6 +518,11 @@ int main() {
         test_delete_and_traversal();
         test_empty_and_clear();
         test_edge_cases();
+        test_whole_tree_operations();
+        test_parallel_matches_sequential();
+        test_augmented_aggregates();
+        test_node_handles();
+        test_flat_combining();
         std::cout << "All tests passed!" << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Test failed: " << e.what() << std::endl;
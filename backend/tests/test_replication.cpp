@@ -0,0 +1,200 @@
+#include "api/replication.h"
+#include "rbtree/string_key.h"
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// A key set standing in for TreeAPI's index on either side
+template<typename Key>
+struct Replica {
+    std::mutex mutex;
+    std::set<Key> keys;
+    std::atomic<uint64_t> version{1};
+
+    void apply(const ReplicaCommit<Key>& commit) {
+        std::lock_guard<std::mutex> lock(mutex);
+        applyLocked(commit);
+    }
+
+    void applyLocked(const ReplicaCommit<Key>& commit) {
+        for (const auto& op : commit.ops) {
+            if (op.first == ReplicaOp::Insert) keys.insert(op.second);
+            if (op.first == ReplicaOp::Remove) keys.erase(op.second);
+            if (op.first == ReplicaOp::Clear) keys.clear();
+        }
+        version = commit.version;
+    }
+
+    ReplicaSnapshot<Key> snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return {version.load(), std::vector<Key>(keys.begin(), keys.end())};
+    }
+
+    typename ReplicationFollower<Key>::Sink sink() {
+        typename ReplicationFollower<Key>::Sink sink;
+        sink.version = [this] { return version.load(); };
+        sink.applySnapshot = [this](ReplicaSnapshot<Key>&& snapshot) {
+            std::lock_guard<std::mutex> lock(mutex);
+            keys = std::set<Key>(snapshot.keys.begin(), snapshot.keys.end());
+            version = snapshot.version;
+        };
+        sink.applyCommit = [this](const ReplicaCommit<Key>& commit) { apply(commit); };
+        return sink;
+    }
+
+    std::set<Key> copy() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return keys;
+    }
+};
+
+// The leader side of TreeAPI::commitLocked(): apply, bump and ship under
+// one lock, so a snapshot never sees a version the log does not have yet
+template<typename Key>
+void commit(Replica<Key>& leaderState, ReplicationLeader<Key>& leader, ReplicaOp op, const Key& key) {
+    std::lock_guard<std::mutex> lock(leaderState.mutex);
+    ReplicaCommit<Key> change;
+    change.ops.emplace_back(op, key);
+    change.version = leaderState.version + 1;
+    leaderState.applyLocked(change);
+    leader.append(change);
+}
+
+template<typename F>
+bool waitFor(F&& done) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+void test_snapshot_then_stream() {
+    Replica<int64_t> source;
+    ReplicationLeader<int64_t> leader(100000);
+    assert(leader.start(0, source.version, [&source] { return source.snapshot(); }) && "Leader should listen");
+    for (int64_t k = 0; k < 5000; k++) commit(source, leader, ReplicaOp::Insert, k);
+
+    // A new follower starts from a snapshot, then from the log
+    Replica<int64_t> a, b;
+    ReplicationFollower<int64_t> followerA("127.0.0.1", leader.port(), a.sink());
+    ReplicationFollower<int64_t> followerB("localhost", leader.port(), b.sink());
+    followerA.start();
+    followerB.start();
+    for (int64_t k = 0; k < 5000; k += 3) commit(source, leader, ReplicaOp::Remove, k);
+    commit(source, leader, ReplicaOp::Insert, int64_t(-7));
+
+    const uint64_t target = source.version;
+    assert(waitFor([&] { return a.version == target && b.version == target; }) && "Followers should catch up");
+    assert(a.copy() == source.copy() && b.copy() == source.copy() && "Followers should hold the leader's keys");
+    assert(followerA.status().snapshots == 1 && followerA.status().connected);
+
+    // Acks and heartbeats bring both sides' lag to zero
+    assert(waitFor([&] {
+        auto status = leader.status();
+        if (status.followers.size() != 2) return false;
+        for (const auto& follower : status.followers) {
+            if (follower.ackedVersion != target) return false;
+        }
+        return true;
+    }) && "Leader should see both followers acknowledge the last commit");
+    assert(waitFor([&] {
+        auto status = followerB.status();
+        return status.leaderVersion == target && status.lagMs == 0;
+    }));
+
+    // Clear replicates like any other op
+    commit(source, leader, ReplicaOp::Clear, int64_t(0));
+    assert(waitFor([&] { return a.version == source.version; }) && a.copy().empty());
+}
+
+void test_resume_and_resync() {
+    Replica<int64_t> source;
+    ReplicationLeader<int64_t> leader(16);
+    assert(leader.start(0, source.version, [&source] { return source.snapshot(); }));
+    Replica<int64_t> replica;
+    ReplicationFollower<int64_t> follower("127.0.0.1", leader.port(), replica.sink());
+    follower.start();
+    commit(source, leader, ReplicaOp::Insert, int64_t(1));
+    assert(waitFor([&] { return replica.version == source.version; }));
+    assert(follower.status().snapshots == 1);
+
+    // Reconnecting within the log window resumes without a snapshot
+    follower.stop();
+    for (int64_t k = 2; k < 12; k++) commit(source, leader, ReplicaOp::Insert, k);
+    follower.start();
+    assert(waitFor([&] { return replica.version == source.version; }));
+    assert(follower.status().snapshots == 1 && replica.copy() == source.copy());
+
+    // Falling further behind than the log forces a fresh snapshot
+    follower.stop();
+    for (int64_t k = 12; k < 60; k++) commit(source, leader, ReplicaOp::Insert, k);
+    follower.start();
+    assert(waitFor([&] { return replica.version == source.version; }));
+    assert(follower.status().snapshots == 2 && replica.copy() == source.copy());
+}
+
+void test_string_keys_and_type_mismatch() {
+    Replica<rbtree::StringKey> source;
+    ReplicationLeader<rbtree::StringKey> leader(100);
+    assert(leader.start(0, source.version, [&source] { return source.snapshot(); }));
+    commit(source, leader, ReplicaOp::Insert, rbtree::StringKey(std::string(300, 'x')));
+    commit(source, leader, ReplicaOp::Insert, rbtree::StringKey("user:42"));
+
+    Replica<rbtree::StringKey> replica;
+    ReplicationFollower<rbtree::StringKey> follower("127.0.0.1", leader.port(), replica.sink());
+    follower.start();
+    commit(source, leader, ReplicaOp::Insert, rbtree::StringKey(""));
+    assert(waitFor([&] { return replica.version == source.version; }));
+    assert(replica.copy() == source.copy() && replica.copy().size() == 3);
+
+    // An int64 follower is refused rather than misreading string keys
+    Replica<int64_t> wrong;
+    ReplicationFollower<int64_t> mismatched("127.0.0.1", leader.port(), wrong.sink());
+    mismatched.start();
+    assert(waitFor([&] { return mismatched.status().lastError.find("string keys") != std::string::npos; }));
+    assert(wrong.version == 1 && wrong.copy().empty());
+}
+
+void test_restarted_leader_with_lower_versions() {
+    Replica<int64_t> first;
+    auto leaderA = std::make_unique<ReplicationLeader<int64_t>>(100);
+    assert(leaderA->start(0, first.version, [&first] { return first.snapshot(); }));
+    const int port = leaderA->port();
+    for (int64_t k = 0; k < 50; k++) commit(first, *leaderA, ReplicaOp::Insert, k);
+
+    Replica<int64_t> replica;
+    ReplicationFollower<int64_t> follower("127.0.0.1", port, replica.sink());
+    follower.start();
+    assert(waitFor([&] { return replica.version == first.version; }));
+
+    // A leader restarted from older data counts from a lower version; the
+    // follower must adopt its snapshot even though its own version is ahead
+    leaderA->stop();
+    leaderA.reset();
+    Replica<int64_t> second;
+    ReplicationLeader<int64_t> leaderB(100);
+    assert(leaderB.start(port, second.version, [&second] { return second.snapshot(); }) &&
+           "The restarted leader should rebind the same port");
+    commit(second, leaderB, ReplicaOp::Insert, int64_t(100));
+    commit(second, leaderB, ReplicaOp::Insert, int64_t(101));
+    assert(waitFor([&] { return follower.status().snapshots == 2 && replica.version == second.version; }) &&
+           "The follower should resync from the new leader");
+    assert(replica.version == 3 && replica.copy() == second.copy());
+}
+
+int main() {
+    test_snapshot_then_stream();
+    test_resume_and_resync();
+    test_string_keys_and_type_mismatch();
+    test_restarted_leader_with_lower_versions();
+    std::cout << "All replication tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "api/response_cache.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void test_hit_and_version_invalidation() {
+    ResponseCache cache;
+    int builds = 0;
+    auto build = [&builds] { builds++; return std::string("v") + std::to_string(builds); };
+
+    assert(*cache.get("stats", 1, cache.generation(), build) == "v1" && "First request should build");
+    assert(*cache.get("stats", 1, cache.generation(), build) == "v1" && "Same version should hit");
+    assert(builds == 1 && "Hit should not rebuild");
+
+    assert(*cache.get("stats", 2, cache.generation(), build) == "v2" && "Newer version should rebuild");
+    assert(*cache.get("tree", 2, cache.generation(), build) == "v3" && "Keys should be cached separately");
+    assert(*cache.get("stats", 2, cache.generation(), build) == "v2" && "Other keys should not evict");
+
+    cache.clear();
+    assert(*cache.get("stats", 2, cache.generation(), build) == "v4" && "Cleared cache should rebuild");
+
+    auto stats = cache.stats();
+    assert(stats.misses == 4 && stats.hits == 2 && "Counters should track hits and builds");
+}
+
+void test_concurrent_misses_single_flight() {
+    ResponseCache cache;
+    std::atomic<int> builds{0};
+    std::atomic<int> inFlight{0};
+    auto slowBuild = [&] {
+        assert(++inFlight == 1 && "Only one builder may run per key");
+        builds++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        inFlight--;
+        return std::string("payload");
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<ResponseCache::Bytes> results(16);
+    for (int i = 0; i < 16; i++) {
+        threads.emplace_back([&, i] { results[i] = cache.get("tree", 7, cache.generation(), slowBuild); });
+    }
+    for (auto& t : threads) t.join();
+
+    assert(builds == 1 && "Concurrent misses should share one build");
+    for (auto& bytes : results) {
+        assert(bytes == results[0] && "Every waiter should get the same bytes");
+    }
+    auto stats = cache.stats();
+    assert(stats.misses == 1 && stats.hits + stats.coalesced == 15 && "Waiters should be coalesced");
+}
+
+void test_builder_failure_releases_waiters() {
+    ResponseCache cache;
+    bool threw = false;
+    try {
+        cache.get("validate", 1, cache.generation(), []() -> std::string { throw std::runtime_error("boom"); });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw && "Builder errors should propagate");
+    assert(*cache.get("validate", 1, cache.generation(), [] { return std::string("ok"); }) == "ok" &&
+           "A failed build should not leave the key stuck");
+}
+
+void test_generation_guards_restarted_versions() {
+    // A follower that adopts a new leader's snapshot can go from version 50
+    // down to 3; nothing cached or built before that may be served after
+    ResponseCache cache;
+    auto old = [] { return std::string("old epoch"); };
+    auto fresh = [] { return std::string("new epoch"); };
+    assert(*cache.get("stats", 50, cache.generation(), old) == "old epoch");
+
+    // A reader that saw version 50 before the swap builds from the new tree
+    const uint64_t before = cache.generation();
+    cache.clear();
+    assert(*cache.get("stats", 50, before, fresh) == "new epoch" && "A stale reader still gets its build");
+    assert(*cache.get("stats", 3, cache.generation(), fresh) == "new epoch" &&
+           "Nothing from the old generation should be served at the new epoch's versions");
+    assert(*cache.get("stats", 3, cache.generation(), old) == "new epoch" && "The new epoch's entry should hit");
+
+    // A build that straddles clear() keeps its slot but must not fill it
+    const uint64_t straddling = cache.generation();
+    auto swapDuringBuild = [&cache] {
+        cache.clear();
+        return std::string("straddled");
+    };
+    assert(*cache.get("tree", 50, straddling, swapDuringBuild) == "straddled");
+    assert(*cache.get("tree", 3, cache.generation(), fresh) == "new epoch" &&
+           "A build that straddled clear() should not be cached");
+}
+
+void test_clear_with_parked_waiters() {
+    // Snapshots clear the cache while pollers wait on a build. The builder
+    // clears as soon as it returns, before the woken waiters get the lock;
+    // their slots must outlive that (-fsanitize=address shows misuse).
+    ResponseCache cache;
+    for (int round = 0; round < 50; round++) {
+        std::atomic<bool> building{false};
+        std::atomic<int> parked{0};
+        std::atomic<bool> returned{false};
+        auto slowBuild = [&] {
+            building = true;
+            while (parked < 7) std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            return std::string("payload");
+        };
+        std::vector<ResponseCache::Bytes> results(8);
+        std::thread builder([&] {
+            results[0] = cache.get("stats", 1, cache.generation(), slowBuild);
+            returned = true;
+            cache.clear();
+        });
+        while (!building) std::this_thread::yield();
+        std::vector<std::thread> waiters;
+        for (int i = 1; i < 8; i++) {
+            waiters.emplace_back([&, i] {
+                parked++;
+                results[i] = cache.get("stats", 1, cache.generation(), slowBuild);
+            });
+        }
+        // And again from another thread in case the scheduler woke a waiter
+        // before the builder got there
+        std::thread clearer([&] {
+            while (!returned) std::this_thread::yield();
+            cache.clear();
+        });
+        builder.join();
+        clearer.join();
+        for (auto& t : waiters) t.join();
+        for (auto& bytes : results) assert(bytes && *bytes == "payload");
+    }
+    assert(*cache.get("stats", 1, cache.generation(), [] { return std::string("after"); }) == "after" &&
+           "A cleared slot should build again");
+}
+
+int main() {
+    test_hit_and_version_invalidation();
+    test_concurrent_misses_single_flight();
+    test_builder_failure_releases_waiters();
+    test_generation_guards_restarted_versions();
+    test_clear_with_parked_waiters();
+    std::cout << "All response cache tests passed!" << std::endl;
+    return 0;
+}
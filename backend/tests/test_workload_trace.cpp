@@ -0,0 +1,125 @@
+#include "api/workload_trace.h"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const std::string kPath = "/tmp/rbtree_test_trace.bin";
+
+static TraceRecord makeRecord(TraceOp op, uint64_t startNs, uint64_t durationNs, uint16_t status) {
+    TraceRecord record;
+    record.op = op;
+    record.startNs = startNs;
+    record.durationNs = durationNs;
+    record.status = status;
+    return record;
+}
+
+void test_int_round_trip() {
+    std::vector<TraceRecord> written;
+    {
+        auto writer = WorkloadTraceWriter::open(kPath, TraceKeyType::Int64);
+        assert(writer && "Trace file should be created");
+        for (int i = 0; i < 1000; i++) {
+            // Starts go backwards now and then, as calls finish out of order
+            TraceRecord record = makeRecord(static_cast<TraceOp>(i % kTraceOpCount),
+                                            1000000 + i * 5000 - (i % 7 == 0 ? 12000 : 0),
+                                            i * 37, i % 11 == 0 ? 400 : 200);
+            record.hasKey = i % 3 != 0;
+            record.intKey = i % 2 ? -(int64_t(1) << 40) - i : i;
+            if (!record.hasKey) record.intKey = 0;
+            if (record.op == TraceOp::Aggregate) {
+                record.aggregate = static_cast<TraceAggregate>(i % kTraceAggregateCount);
+                record.hasUpperKey = i % 4 != 0;
+                record.upperIntKey = record.hasUpperKey ? int64_t(i) << 33 : 0;
+            }
+            if (record.op == TraceOp::Insert) record.ttlMs = i % 5 ? i * 1000 : -1;
+            writer->append(record);
+            written.push_back(record);
+        }
+        assert(writer->records() == 1000 && "Writer should count records");
+    }
+
+    WorkloadTrace trace;
+    std::string error;
+    assert(WorkloadTrace::load(kPath, trace, error) && "Trace should load");
+    assert(trace.keyType == TraceKeyType::Int64 && !trace.truncated && trace.captureStartUnixNs > 0);
+    assert(trace.records.size() == written.size() && "Every record should come back");
+    for (size_t i = 0; i < written.size(); i++) {
+        const TraceRecord& a = written[i];
+        const TraceRecord& b = trace.records[i];
+        assert(a.op == b.op && a.startNs == b.startNs && a.durationNs == b.durationNs &&
+               a.status == b.status && a.hasKey == b.hasKey && a.intKey == b.intKey &&
+               a.aggregate == b.aggregate && a.hasUpperKey == b.hasUpperKey &&
+               a.upperIntKey == b.upperIntKey && a.ttlMs == b.ttlMs && "Records should round-trip exactly");
+    }
+}
+
+void test_string_round_trip_and_truncation() {
+    {
+        auto writer = WorkloadTraceWriter::open(kPath, TraceKeyType::String);
+        TraceRecord record = makeRecord(TraceOp::Insert, 10, 20, 200);
+        record.hasKey = true;
+        record.stringKey = std::string("user:\0\"42\"", 10);
+        writer->append(record);
+        record.op = TraceOp::Search;
+        record.stringKey = std::string(300, 'x');
+        writer->append(record);
+        record.op = TraceOp::Aggregate;
+        record.aggregate = TraceAggregate::Max;
+        record.hasKey = false;
+        record.hasUpperKey = true;
+        record.upperStringKey = "user:9";
+        writer->append(record);
+    }
+
+    WorkloadTrace trace;
+    std::string error;
+    assert(WorkloadTrace::load(kPath, trace, error) && trace.keyType == TraceKeyType::String);
+    assert(trace.records.size() == 3 && trace.records[0].stringKey == std::string("user:\0\"42\"", 10) &&
+           trace.records[1].stringKey == std::string(300, 'x') && "String keys should round-trip");
+    const TraceRecord& range = trace.records[2];
+    assert(trace.records.size() == 3 && range.op == TraceOp::Aggregate && range.aggregate == TraceAggregate::Max &&
+           !range.hasKey && range.hasUpperKey && range.upperStringKey == "user:9" &&
+           "Open-ended aggregate ranges should round-trip");
+
+    // Cut the last record in half: the first one must survive
+    std::ifstream in(kPath, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream(kPath, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size() - 120);
+    assert(WorkloadTrace::load(kPath, trace, error) && trace.truncated && trace.records.size() == 1 &&
+           "A truncated tail should keep the complete records");
+
+    std::ofstream(kPath, std::ios::binary | std::ios::trunc) << "not a trace at all, just text";
+    assert(!WorkloadTrace::load(kPath, trace, error) && !error.empty() && "Foreign files should be rejected");
+    std::remove(kPath.c_str());
+}
+
+void test_version_2_inserts() {
+    // Before version 3 an Insert record had no ttl
+    std::string bytes("RBTTRACE", 8);
+    bytes += '\x02';
+    bytes.append(15, '\0');
+    const unsigned char record[] = {static_cast<unsigned char>(TraceOp::Insert) | 0x80, 0, 0, 0xc8, 0x01, 14};
+    bytes.append(reinterpret_cast<const char*>(record), sizeof(record));
+    std::ofstream(kPath, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+
+    WorkloadTrace trace;
+    std::string error;
+    assert(WorkloadTrace::load(kPath, trace, error) && !trace.truncated && trace.records.size() == 1);
+    const TraceRecord& insert = trace.records[0];
+    assert(insert.op == TraceOp::Insert && insert.status == 200 && insert.hasKey && insert.intKey == 7 &&
+           insert.ttlMs == -1 && "Version 2 inserts should load with the default ttl");
+    std::remove(kPath.c_str());
+}
+
+int main() {
+    test_int_round_trip();
+    test_string_round_trip_and_truncation();
+    test_version_2_inserts();
+    std::cout << "All workload trace tests passed!" << std::endl;
+    return 0;
+}
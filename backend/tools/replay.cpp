@@ -0,0 +1,503 @@
+// Replays a workload trace captured with RBT_CAPTURE and reports throughput
+// and latency percentiles per route, next to the latencies the server saw
+// while capturing.
+//
+// Usage: ./rbtree_replay <trace> [options]
+//   --direct            run against an in-process index (default)
+//   --engine NAME       index engine for --direct, see rbtree::indexEngines() (default rb)
+//   --http HOST:PORT    send the calls to a running server instead
+//   --connections N     HTTP connections (default 1, which keeps trace order)
+//   --speed S           max (default), original, or a multiplier such as 2
+//
+// Paced runs (original or a multiplier) measure each call from its
+// scheduled start, so a replay that falls behind shows the queueing delay
+// instead of hiding it. Random inserts replay as inserts of the value the
+// server picked, which makes every replay of a trace apply the same
+// mutations. Direct replays time the index work only: /api/tree is a full
+// scan, stats is height plus validation.
+//
+// Keys the server expired or evicted on its own are in the trace as Expire
+// and Evict records. Direct replays apply them as removals, since the index
+// has no TTLs; HTTP replays skip them and send each insert's ttl instead, so
+// a target configured like the captured server removes the same keys.
+#include "api/workload_trace.h"
+#include "rbtree/ordered_index.h"
+#include "rbtree/string_key.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string tracePath;
+    std::string engine = "rb";
+    std::string host;
+    int port = 0;
+    size_t connections = 1;
+    double speed = 0;  // 0 = as fast as possible
+};
+
+struct Sample {
+    TraceOp op;
+    uint64_t latencyNs;
+    bool error;
+    bool statusChanged;
+};
+
+// When record i is due: its captured offset scaled by speed, or now when unpaced
+struct Schedule {
+    const WorkloadTrace& trace;
+    double speed;
+    Clock::time_point begin;
+
+    Clock::time_point at(size_t i) const {
+        if (speed <= 0) return Clock::now();
+        const uint64_t first = trace.records.front().startNs;
+        const uint64_t offset = trace.records[i].startNs > first ? trace.records[i].startNs - first : 0;
+        return begin + std::chrono::nanoseconds(static_cast<uint64_t>(offset / speed));
+    }
+};
+
+// Calls are appended when they finish, but Expire and Evict when the key is
+// removed, under the tree lock: ahead of the insert that caused an eviction
+// and of inserts that committed before it but had not answered yet. Every
+// such call started before the removal, so each removal moves behind the
+// calls that started before it.
+void placeRemovals(WorkloadTrace& trace) {
+    std::vector<TraceRecord> ordered;
+    ordered.reserve(trace.records.size());
+    std::deque<TraceRecord> removals;  // in removal order, as appended
+    for (auto& record : trace.records) {
+        if (!traceOpIsCall(record.op)) {
+            removals.push_back(std::move(record));
+            continue;
+        }
+        while (!removals.empty() && removals.front().startNs <= record.startNs) {
+            ordered.push_back(std::move(removals.front()));
+            removals.pop_front();
+        }
+        ordered.push_back(std::move(record));
+    }
+    for (auto& removal : removals) ordered.push_back(std::move(removal));
+    trace.records = std::move(ordered);
+}
+
+// sleep_until alone overshoots by the timer slack (~50-100 us), which would
+// show up as latency in paced runs; sleep most of the way, then spin
+void waitUntil(Clock::time_point t) {
+    const auto spin = std::chrono::microseconds(200);
+    if (t - Clock::now() > spin) std::this_thread::sleep_until(t - spin);
+    while (Clock::now() < t) {
+    }
+}
+
+// --- direct -------------------------------------------------------------
+
+template<typename Key> Key keyOf(int64_t intKey, const std::string& stringKey);
+template<> int64_t keyOf<int64_t>(int64_t intKey, const std::string&) { return intKey; }
+template<> rbtree::StringKey keyOf<rbtree::StringKey>(int64_t, const std::string& stringKey) { return stringKey; }
+
+template<typename Key>
+bool runDirect(const WorkloadTrace& trace, const Options& options, std::vector<Sample>& samples) {
+    auto index = rbtree::makeOrderedIndex<Key>(options.engine);
+    if (!index) {
+        std::cerr << "Unknown engine '" << options.engine << "'" << std::endl;
+        return false;
+    }
+    // Keys are decoded up front so the timed loop only touches the index
+    std::vector<Key> keys(trace.records.size());
+    std::vector<Key> upperKeys(trace.records.size());
+    for (size_t i = 0; i < trace.records.size(); i++) {
+        const TraceRecord& record = trace.records[i];
+        if (record.hasKey) keys[i] = keyOf<Key>(record.intKey, record.stringKey);
+        if (record.hasUpperKey) upperKeys[i] = keyOf<Key>(record.upperIntKey, record.upperStringKey);
+    }
+
+    samples.reserve(trace.records.size());
+    const Schedule schedule{trace, options.speed, Clock::now()};
+    size_t sink = 0;
+    for (size_t i = 0; i < trace.records.size(); i++) {
+        const TraceRecord& record = trace.records[i];
+        const auto start = schedule.at(i);
+        waitUntil(start);
+        switch (record.op) {
+            case TraceOp::Insert:
+            case TraceOp::Random: if (record.hasKey) index->insert(keys[i]); break;
+            case TraceOp::Delete:
+            case TraceOp::Expire:
+            case TraceOp::Evict: if (record.hasKey) index->remove(keys[i]); break;
+            case TraceOp::Search: if (record.hasKey) sink += index->contains(keys[i]); break;
+            case TraceOp::Clear: index->clear(); break;
+            case TraceOp::Tree: index->forEach([&sink](const Key&) { sink++; }); break;
+            case TraceOp::Stats: sink += index->height() + index->validate(); break;
+            case TraceOp::Validate: sink += index->validate(); break;
+            case TraceOp::Aggregate:
+                sink += index->rangeStats(record.hasKey ? &keys[i] : nullptr,
+                                          record.hasUpperKey ? &upperKeys[i] : nullptr).count;
+                break;
+            case TraceOp::Health: break;
+        }
+        const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        samples.push_back({record.op, static_cast<uint64_t>(latency.count()), false, false});
+    }
+    volatile size_t consumed = sink;  // keeps the read-only calls from being optimized out
+    (void)consumed;
+    std::cout << "Final index: " << index->size() << " keys" << std::endl;
+    return true;
+}
+
+// --- HTTP ---------------------------------------------------------------
+
+int connectTo(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) return -1;
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval tv{30, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    return fd;
+}
+
+// Sends one request and reads the whole response. Returns the HTTP status,
+// or 0 on a transport error; `keepAlive` says whether the socket is reusable.
+int roundTrip(int fd, const std::string& request, bool& keepAlive) {
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return 0;
+        sent += static_cast<size_t>(n);
+    }
+
+    std::string buffer;
+    char chunk[16384];
+    size_t headerEnd = std::string::npos;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return 0;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+
+    std::string headers = buffer.substr(0, headerEnd);
+    std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+    size_t length = 0;
+    size_t pos = headers.find("content-length:");
+    if (pos != std::string::npos) length = std::strtoull(headers.c_str() + pos + 15, nullptr, 10);
+    keepAlive = headers.find("connection: close") == std::string::npos;
+
+    while (buffer.size() - (headerEnd + 4) < length) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return 0;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+    return headers.size() > 12 ? std::atoi(headers.c_str() + 9) : 0;
+}
+
+std::string jsonKey(const WorkloadTrace& trace, const TraceRecord& record) {
+    if (!record.hasKey) return "null";
+    if (trace.keyType == TraceKeyType::Int64) return std::to_string(record.intKey);
+    std::string out = "\"";
+    for (unsigned char c : record.stringKey) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+std::string pathKey(const WorkloadTrace& trace, int64_t intKey, const std::string& stringKey) {
+    if (trace.keyType == TraceKeyType::Int64) return std::to_string(intKey);
+    std::string out;
+    for (unsigned char c : stringKey) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            char escaped[4];
+            std::snprintf(escaped, sizeof(escaped), "%%%02X", c);
+            out += escaped;
+        }
+    }
+    return out;
+}
+
+std::string buildRequest(const WorkloadTrace& trace, const TraceRecord& record, const std::string& host) {
+    std::string method = "GET";
+    std::string path;
+    std::string body;
+    switch (record.op) {
+        case TraceOp::Health: path = "/api/health"; break;
+        case TraceOp::Tree: path = "/api/tree"; break;
+        case TraceOp::Stats: path = "/api/tree/stats"; break;
+        case TraceOp::Validate: path = "/api/tree/validate"; break;
+        case TraceOp::Clear: method = "POST"; path = "/api/tree/clear"; break;
+        case TraceOp::Insert:
+        case TraceOp::Random:
+            method = "POST";
+            path = "/api/tree/insert";
+            body = "{\"value\":" + jsonKey(trace, record);
+            if (record.op == TraceOp::Insert && record.ttlMs >= 0) {
+                char ttl[32];
+                std::snprintf(ttl, sizeof(ttl), ",\"ttl\":%.3f", record.ttlMs / 1000.0);
+                body += ttl;
+            }
+            body += "}";
+            break;
+        case TraceOp::Expire:
+        case TraceOp::Evict:
+            return std::string();  // the target's own retention removes these
+        case TraceOp::Delete:
+            method = "DELETE";
+            path = "/api/tree/delete";
+            body = "{\"value\":" + jsonKey(trace, record) + "}";
+            break;
+        case TraceOp::Search:
+            path = "/api/tree/search/" +
+                   (record.hasKey ? pathKey(trace, record.intKey, record.stringKey) : std::string());
+            break;
+        case TraceOp::Aggregate: {
+            path = "/api/tree/aggregate";
+            if (record.aggregate != TraceAggregate::All) {
+                path += std::string("/") + traceAggregateName(record.aggregate);
+            }
+            std::string query;
+            if (record.hasKey) query += "&from=" + pathKey(trace, record.intKey, record.stringKey);
+            if (record.hasUpperKey) query += "&to=" + pathKey(trace, record.upperIntKey, record.upperStringKey);
+            if (!query.empty()) path += "?" + query.substr(1);
+            break;
+        }
+    }
+    std::string request = method + " " + path + " HTTP/1.1\r\nHost: " + host + "\r\n";
+    if (!body.empty() || method != "GET") {
+        request += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    return request + "\r\n" + body;
+}
+
+bool runHttp(const WorkloadTrace& trace, const Options& options, std::vector<Sample>& samples) {
+    std::vector<std::string> requests;
+    requests.reserve(trace.records.size());
+    // Empty for the records that are not calls
+    for (const auto& record : trace.records) requests.push_back(buildRequest(trace, record, options.host));
+
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<Sample>> perConnection(options.connections);
+    const Schedule schedule{trace, options.speed, Clock::now()};
+    std::vector<std::thread> workers;
+    for (size_t c = 0; c < options.connections; c++) {
+        workers.emplace_back([&, c] {
+            int fd = -1;
+            size_t i;
+            while ((i = next++) < requests.size()) {
+                if (requests[i].empty()) continue;
+                const auto start = schedule.at(i);
+                waitUntil(start);
+                if (fd < 0) fd = connectTo(options.host, options.port);
+                bool keepAlive = false;
+                const int status = fd < 0 ? 0 : roundTrip(fd, requests[i], keepAlive);
+                const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+                const TraceRecord& record = trace.records[i];
+                perConnection[c].push_back({record.op, static_cast<uint64_t>(latency.count()), status == 0,
+                                            status != 0 && status != record.status});
+                if (fd >= 0 && (status == 0 || !keepAlive)) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+            if (fd >= 0) close(fd);
+        });
+    }
+    for (auto& w : workers) w.join();
+    for (auto& part : perConnection) samples.insert(samples.end(), part.begin(), part.end());
+    return true;
+}
+
+// --- report -------------------------------------------------------------
+
+double percentileUs(std::vector<uint64_t>& values, double p) {
+    if (values.empty()) return 0;
+    const size_t rank = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank] / 1000.0;
+}
+
+void printRow(const std::string& name, std::vector<uint64_t>& latencies, std::vector<uint64_t>& captured,
+              size_t errors, size_t changed) {
+    const double p50 = percentileUs(latencies, 0.50);
+    const double p90 = percentileUs(latencies, 0.90);
+    const double p99 = percentileUs(latencies, 0.99);
+    const double max = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end()) / 1000.0;
+    std::cout << std::setw(9) << name << std::setw(9) << latencies.size() << std::setw(10) << p50
+              << std::setw(10) << p90 << std::setw(10) << p99 << std::setw(11) << max
+              << std::setw(12) << percentileUs(captured, 0.50) << std::setw(12) << percentileUs(captured, 0.99)
+              << std::setw(8) << errors << std::setw(9) << changed << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--direct") {
+            options.host.clear();
+        } else if (arg == "--engine" && hasValue) {
+            options.engine = argv[++i];
+        } else if (arg == "--http" && hasValue) {
+            const std::string target = argv[++i];
+            const size_t colon = target.rfind(':');
+            if (colon == std::string::npos) return false;
+            options.host = target.substr(0, colon);
+            options.port = std::atoi(target.c_str() + colon + 1);
+        } else if (arg == "--connections" && hasValue) {
+            options.connections = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--speed" && hasValue) {
+            const std::string speed = argv[++i];
+            options.speed = speed == "max" ? 0 : speed == "original" ? 1 : std::atof(speed.c_str());
+            if (options.speed < 0) return false;
+        } else if (arg[0] != '-' && options.tracePath.empty()) {
+            options.tracePath = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.tracePath.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " <trace> [--direct] [--engine " << rbtree::indexEngineNames("|") << "]"
+                  << " [--http host:port] [--connections N] [--speed max|original|<multiplier>]" << std::endl;
+        return 2;
+    }
+
+    WorkloadTrace trace;
+    std::string error;
+    if (!WorkloadTrace::load(options.tracePath, trace, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (trace.truncated) {
+        std::cerr << "Warning: " << options.tracePath << " ends mid-record; replaying the first "
+                  << trace.records.size() << " calls" << std::endl;
+    }
+    if (trace.records.empty()) {
+        std::cerr << options.tracePath << " holds no calls" << std::endl;
+        return 1;
+    }
+    placeRemovals(trace);
+    const bool stringKeys = trace.keyType == TraceKeyType::String;
+    uint64_t span = 0;
+    for (const auto& record : trace.records) span = std::max(span, record.startNs + record.durationNs);
+
+    const size_t calls = std::count_if(trace.records.begin(), trace.records.end(),
+                                       [](const TraceRecord& record) { return traceOpIsCall(record.op); });
+    std::cout << "Trace: " << options.tracePath << "  calls: " << calls
+              << "  keys: " << (stringKeys ? "string" : "int64")
+              << "  captured over: " << std::fixed << std::setprecision(2) << span / 1e9 << "s" << std::endl;
+    std::cout << "Replay: ";
+    if (options.host.empty()) {
+        std::cout << "direct, engine " << options.engine;
+    } else {
+        std::cout << "http " << options.host << ":" << options.port << ", " << options.connections
+                  << " connection(s)";
+    }
+    std::cout << ", speed ";
+    if (options.speed <= 0) {
+        std::cout << "max" << std::endl;
+    } else if (options.speed == 1) {
+        std::cout << "original" << std::endl;
+    } else {
+        std::cout << std::defaultfloat << options.speed << "x" << std::fixed << std::endl;
+    }
+
+    std::vector<Sample> samples;
+    const auto begin = Clock::now();
+    bool ran;
+    if (!options.host.empty()) {
+        ran = runHttp(trace, options, samples);
+    } else if (stringKeys) {
+        ran = runDirect<rbtree::StringKey>(trace, options, samples);
+    } else {
+        ran = runDirect<int64_t>(trace, options, samples);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    if (!ran) return 1;
+
+    std::vector<std::vector<uint64_t>> latencies(kTraceOpCount), captured(kTraceOpCount);
+    std::vector<size_t> errors(kTraceOpCount), changed(kTraceOpCount);
+    std::vector<uint64_t> allLatencies, allCaptured;
+    size_t removals = 0;
+    // Expiry and eviction records replay the server's removals but are not
+    // calls; their zero captured durations would drag every percentile down
+    for (const auto& sample : samples) {
+        if (!traceOpIsCall(sample.op)) continue;
+        const size_t op = static_cast<size_t>(sample.op);
+        latencies[op].push_back(sample.latencyNs);
+        allLatencies.push_back(sample.latencyNs);
+        errors[op] += sample.error;
+        changed[op] += sample.statusChanged;
+    }
+    for (const auto& record : trace.records) {
+        if (!traceOpIsCall(record.op)) {
+            removals++;
+            continue;
+        }
+        captured[static_cast<size_t>(record.op)].push_back(record.durationNs);
+        allCaptured.push_back(record.durationNs);
+    }
+
+    std::cout << std::setprecision(1);
+    std::cout << std::setw(9) << "route" << std::setw(9) << "calls" << std::setw(10) << "p50 us"
+              << std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << std::setw(11) << "max us"
+              << std::setw(12) << "capt p50" << std::setw(12) << "capt p99"
+              << std::setw(8) << "errors" << std::setw(9) << "status!=" << std::endl;
+    size_t totalErrors = 0, totalChanged = 0;
+    for (size_t op = 0; op < kTraceOpCount; op++) {
+        if (latencies[op].empty()) continue;
+        printRow(traceOpName(static_cast<TraceOp>(op)), latencies[op], captured[op], errors[op], changed[op]);
+        totalErrors += errors[op];
+        totalChanged += changed[op];
+    }
+    printRow("all", allLatencies, allCaptured, totalErrors, totalChanged);
+    if (removals > 0) std::cout << "Server removals (expire/evict): " << removals << ", not in the latencies" << std::endl;
+    std::cout << "Throughput: " << std::setprecision(0) << allLatencies.size() / seconds << " calls/s over "
+              << std::setprecision(2) << seconds << "s" << std::endl;
+    return totalErrors == 0 ? 0 : 1;
+}